@@ -0,0 +1,472 @@
+/*
+ * @Author: zyxeeker zyxeeker@gmail.com
+ * @Date: 2026-10-18 14:20:05
+ * @LastEditors: zyxeeker zyxeeker@gmail.com
+ * @LastEditTime: 2026-10-18 14:20:05
+ * @Description: 基于线程池的 C++20 协程, 需以 C++20 编译
+ */
+
+#ifndef __SEEKER_CORO_HPP__
+#define __SEEKER_CORO_HPP__
+
+#include "thread.hpp"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <optional>
+#include <exception>
+#include <coroutine>
+#include <condition_variable>
+
+namespace seeker {
+
+template <typename T>
+class CoTask;
+
+template <typename T>
+class CoPromiseBase {
+  /**
+   * @brief 结束时直接切换到等待方, 不经过线程池
+   */
+  struct FinalAwaiter {
+    bool await_ready() noexcept {
+      return false;
+    }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+      auto continuation = handle.promise().continuation();
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+ public:
+  std::suspend_always initial_suspend() noexcept {
+    return {};
+  }
+  FinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+  void unhandled_exception() {
+    error_ = std::current_exception();
+  }
+  inline std::coroutine_handle<> continuation() const {
+    return continuation_;
+  }
+  inline void set_continuation(std::coroutine_handle<> handle) {
+    continuation_ = handle;
+  }
+
+ protected:
+  std::coroutine_handle<> continuation_;
+  std::exception_ptr error_;
+};
+
+template <typename T>
+class CoPromise : public CoPromiseBase<T> {
+ public:
+  CoTask<T> get_return_object();
+  template <typename U>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+  T result() {
+    if (this->error_) {
+      std::rethrow_exception(this->error_);
+    }
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class CoPromise<void> : public CoPromiseBase<void> {
+ public:
+  CoTask<void> get_return_object();
+  void return_void() {}
+  void result() {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+};
+
+/**
+ * @brief 惰性协程任务, 被 co_await 或 SyncWait 时才开始执行
+ * 协程挂起期间不占用线程, 恢复时运行在唤醒它的线程池线程上
+ */
+template <typename T>
+class CoTask {
+ public:
+  using promise_type = CoPromise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  explicit CoTask(Handle handle)
+      : handle_(handle) {}
+  CoTask(CoTask&& other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+  CoTask& operator=(CoTask&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  CoTask(const CoTask&) = delete;
+  CoTask& operator=(const CoTask&) = delete;
+  ~CoTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  auto operator co_await() & noexcept {
+    return Awaiter{ handle_ };
+  }
+  auto operator co_await() && noexcept {
+    return Awaiter{ handle_ };
+  }
+
+ private:
+  struct Awaiter {
+    Handle Child;
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> handle) noexcept {
+      Child.promise().set_continuation(handle);
+      return Child;
+    }
+    T await_resume() {
+      return Child.promise().result();
+    }
+  };
+
+ private:
+  Handle handle_;
+};
+
+template <typename T>
+CoTask<T> CoPromise<T>::get_return_object() {
+  return CoTask<T>(CoTask<T>::Handle::from_promise(*this));
+}
+
+inline CoTask<void> CoPromise<void>::get_return_object() {
+  return CoTask<void>(CoTask<void>::Handle::from_promise(*this));
+}
+
+/**
+ * @brief 恢复协程的回调, 投递到线程池后由 await_suspend 返回 Suspend() 的结果
+ * 回调未执行即被销毁(被拒绝、丢弃或随 Stop 丢弃)时在销毁它的线程上恢复, 协程不会永远挂起;
+ * 在 await_suspend 返回前即被放弃时不嵌套恢复, 由 Suspend() 返回 false 让协程直接继续
+ */
+class CoResumer {
+ public:
+  explicit CoResumer(std::coroutine_handle<> handle)
+      : state_(std::make_shared<State>()) {
+    state_->Handle = handle;
+  }
+
+  /**
+   * @brief 执行时恢复协程, 未执行即被销毁时改由 Resume 恢复
+   */
+  std::function<void()> Callback() const {
+    return [guard = std::make_shared<Guard>(state_)]() {
+      guard->Resumed = true;
+      guard->Shared->Handle.resume();
+    };
+  }
+  /**
+   * @brief 在当前线程上恢复; 协程尚未挂起时只做标记, 由 Suspend 返回 false
+   */
+  void Resume() const {
+    state_->Resume();
+  }
+  bool Suspend() const {
+    return !state_->Suspended.exchange(true);
+  }
+
+ private:
+  struct State {
+    std::coroutine_handle<> Handle;
+    std::atomic<bool> Suspended{false};
+
+    void Resume() {
+      if (Suspended.exchange(true)) {
+        Handle.resume();
+      }
+    }
+  };
+  struct Guard {
+    std::shared_ptr<State> Shared;
+    bool Resumed = false;
+
+    explicit Guard(std::shared_ptr<State> state)
+        : Shared(std::move(state)) {}
+    ~Guard() {
+      if (!Resumed) {
+        Shared->Resume();
+      }
+    }
+  };
+
+ private:
+  std::shared_ptr<State> state_;
+};
+
+/**
+ * @brief 协程中 co_await Schedule(pool) 后切换到线程池线程继续执行
+ */
+inline auto Schedule(ThreadPool& pool, ThreadPool::PRIORITY priority = ThreadPool::NORMAL) {
+  struct Awaiter {
+    ThreadPool* Pool;
+    ThreadPool::PRIORITY Priority;
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      CoResumer resumer(handle);
+      Pool->Post(Priority, "Schedule", resumer.Callback());
+      return resumer.Suspend();
+    }
+    void await_resume() const noexcept {}
+  };
+  return Awaiter{ &pool, priority };
+}
+
+/**
+ * @brief 挂起当前协程, 到期后在当前线程池线程上恢复
+ * 不在线程池线程上调用时直接阻塞睡眠
+ */
+inline auto SleepFor(std::chrono::nanoseconds duration) {
+  struct Awaiter {
+    std::chrono::nanoseconds Duration;
+
+    bool await_ready() const noexcept {
+      return Duration.count() <= 0;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      auto pool = ThreadPool::Current();
+      if (!pool) {
+        std::this_thread::sleep_for(Duration);
+        return false;
+      }
+      CoResumer resumer(handle);
+      pool->ScheduleAfter(Duration, resumer.Callback());
+      return resumer.Suspend();
+    }
+    void await_resume() const noexcept {}
+  };
+  return Awaiter{ duration };
+}
+
+template <class TaskType>
+struct TaskAwaiter {
+  std::shared_ptr<TaskType> Task;
+
+  bool await_ready() const {
+    return Task->done();
+  }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    auto pool = ThreadPool::Current();
+    CoResumer resumer(handle);
+    Task->OnDone([resumer, pool]() {
+      if (pool) {
+        pool->Post("Resume", resumer.Callback());
+      } else {
+        resumer.Resume();
+      }
+    });
+    return resumer.Suspend();
+  }
+  decltype(auto) await_resume() {
+    return Task->result().get();
+  }
+};
+
+/**
+ * @brief co_await 线程池任务, 任务完成后回到发起等待时所在的线程池恢复
+ */
+template <typename T>
+TaskAwaiter<Task<T> > operator co_await(const std::shared_ptr<Task<T> >& task) {
+  return { task };
+}
+
+template <typename T>
+TaskAwaiter<SharedTask<T> > operator co_await(const std::shared_ptr<SharedTask<T> >& task) {
+  return { task };
+}
+
+class SyncWaiter {
+ public:
+  struct Latch {
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    bool Done = false;
+  };
+
+  struct promise_type {
+    Latch* Sync = nullptr;
+
+    SyncWaiter get_return_object() {
+      return SyncWaiter(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+    /**
+     * @brief 协程已挂起后才通知, 等待方醒来即可安全销毁协程
+     */
+    auto final_suspend() noexcept {
+      struct Awaiter {
+        bool await_ready() noexcept {
+          return false;
+        }
+        void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+          auto sync = handle.promise().Sync;
+          std::lock_guard<std::mutex> l(sync->Mutex);
+          sync->Done = true;
+          sync->Cv.notify_all();
+        }
+        void await_resume() noexcept {}
+      };
+      return Awaiter{};
+    }
+    void return_void() {}
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+
+  explicit SyncWaiter(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+  SyncWaiter(const SyncWaiter&) = delete;
+  SyncWaiter& operator=(const SyncWaiter&) = delete;
+  ~SyncWaiter() {
+    handle_.destroy();
+  }
+
+  void Wait() {
+    Latch sync;
+    handle_.promise().Sync = &sync;
+    handle_.resume();
+    std::unique_lock<std::mutex> l(sync.Mutex);
+    sync.Cv.wait(l, [&](){ return sync.Done; });
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief 在普通线程(如 main)中阻塞等待协程完成并返回结果, 不应在线程池线程上调用
+ */
+template <typename T>
+T SyncWait(CoTask<T> task) {
+  std::optional<std::conditional_t<std::is_void<T>::value, bool, T> > value;
+  std::exception_ptr error;
+  auto body = [&]() -> SyncWaiter {
+    try {
+      if constexpr (std::is_void<T>::value) {
+        co_await task;
+        value.emplace(true);
+      } else {
+        value.emplace(co_await task);
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+  };
+  body().Wait();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if constexpr (!std::is_void<T>::value) {
+    return std::move(*value);
+  }
+}
+
+/**
+ * @brief 同时启动所有协程, 全部完成后恢复等待方, 首个异常在等待方重新抛出
+ */
+inline CoTask<void> WhenAll(std::vector<CoTask<void> > tasks) {
+  struct State {
+    std::atomic<size_t> Remaining;
+    std::coroutine_handle<> Parent;
+    std::mutex Mutex;
+    std::exception_ptr Error;
+  };
+  struct Starter {
+    struct promise_type {
+      Starter get_return_object() {
+        return {};
+      }
+      std::suspend_never initial_suspend() noexcept {
+        return {};
+      }
+      std::suspend_never final_suspend() noexcept {
+        return {};
+      }
+      void return_void() {}
+      void unhandled_exception() {
+        std::terminate();
+      }
+    };
+  };
+  struct Join {
+    State* Shared;
+
+    bool await_ready() const noexcept {
+      return Shared->Remaining.load() == 0;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      Shared->Parent = handle;
+      // 计数多预留了 1, 由等待方在设置好 Parent 后释放
+      return Shared->Remaining.fetch_sub(1) != 1;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  State state;
+  state.Remaining = tasks.size() + 1;
+  auto start = [](CoTask<void>& task, State* state) -> Starter {
+    try {
+      co_await task;
+    } catch (...) {
+      std::lock_guard<std::mutex> l(state->Mutex);
+      if (!state->Error) {
+        state->Error = std::current_exception();
+      }
+    }
+    if (state->Remaining.fetch_sub(1) == 1) {
+      state->Parent.resume();
+    }
+  };
+  for (auto& task : tasks) {
+    start(task, &state);
+  }
+  co_await Join{ &state };
+  if (state.Error) {
+    std::rethrow_exception(state.Error);
+  }
+}
+
+} // namespace seeker
+
+#endif // __cpp_impl_coroutine
+
+#endif // __SEEKER_CORO_HPP__
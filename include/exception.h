@@ -61,6 +61,30 @@ class OtherError : public Exception {
   OtherError(std::string str);
 };
 
+/**
+ * @brief 任务被拒绝执行, 如线程池队列已满
+ */
+class RejectedError : public Exception {
+ public:
+  static RejectedError Create(std::string module_name, 
+                              std::string explanatory_str, 
+                              int32_t erro_num = 0);
+ private:
+  RejectedError(std::string str);
+};
+
+/**
+ * @brief 任务被取消或超过截止时间
+ */
+class CancelledError : public Exception {
+ public:
+  static CancelledError Create(std::string module_name, 
+                               std::string explanatory_str, 
+                               int32_t erro_num = 0);
+ private:
+  CancelledError(std::string str);
+};
+
 } // seeker
 
 #endif // __SEEKER_EXCEPTION_H__
@@ -0,0 +1,350 @@
+/*
+ * @Author: zyxeeker zyxeeker@gmail.com
+ * @Date: 2026-10-18 16:05:41
+ * @LastEditors: zyxeeker zyxeeker@gmail.com
+ * @LastEditTime: 2026-10-18 16:05:41
+ * @Description: 轻量的 Promise/Future, 以一个原子状态字同步, 等待方在状态字上 futex 休眠
+ */
+
+#ifndef __SEEKER_FUTURE_HPP__
+#define __SEEKER_FUTURE_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <utility>
+#include <optional>
+#include <exception>
+#include <type_traits>
+
+namespace seeker {
+
+/**
+ * @brief Promise/Future 的共享状态, 结果只能设置一次
+ * 等待方先短暂自旋, 仍未就绪时在状态字上 futex 休眠; 设置方只在有休眠者时才进入内核唤醒
+ */
+class FutureStateBase {
+ public:
+  FutureStateBase() = default;
+  FutureStateBase(const FutureStateBase&) = delete;
+  FutureStateBase& operator=(const FutureStateBase&) = delete;
+
+  inline bool ready() const {
+    return state_.load(std::memory_order_acquire) & READY;
+  }
+  /**
+   * @brief 阻塞至结果就绪, 在线程池线程上等待时先协助执行本池排队中的任务
+   */
+  void Wait() const;
+  /**
+   * @brief 最多等待 timeout
+   * @return true 结果已就绪
+   */
+  bool WaitFor(std::chrono::nanoseconds timeout) const;
+
+  void SetException(std::exception_ptr error) {
+    error_ = std::move(error);
+    Publish();
+  }
+  /**
+   * @brief 标记结果已被 Future 取走, 结果只能取走一次
+   * @return false 已被取走过
+   */
+  inline bool Consume() {
+    return !consumed_.exchange(true, std::memory_order_relaxed);
+  }
+  inline bool consumed() const {
+    return consumed_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  enum STATE : uint32_t {
+    READY = 1,
+    /**
+     * @brief 有线程在状态字上休眠, 设置结果时需要唤醒
+     */
+    WAITING = 2,
+  };
+
+  /**
+   * @brief 结果已写入, 置为就绪并唤醒休眠的等待方
+   */
+  void Publish();
+  void Rethrow() const {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  mutable std::atomic<uint32_t> state_{0};
+  std::atomic<bool> consumed_{false};
+  std::exception_ptr error_;
+};
+
+template <typename T>
+class FutureState : public FutureStateBase {
+ public:
+  template <typename U>
+  void SetValue(U&& value) {
+    value_.emplace(std::forward<U>(value));
+    Publish();
+  }
+  /**
+   * @brief 就绪后访问结果, 有异常时重新抛出
+   */
+  T& value() {
+    Rethrow();
+    return *value_;
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+/**
+ * @brief 结果为引用时只保存所引用对象的地址, 由设置方保证对象在取走结果后仍然有效
+ */
+template <typename T>
+class FutureState<T&> : public FutureStateBase {
+ public:
+  void SetValue(T& value) {
+    value_ = &value;
+    Publish();
+  }
+  T& value() {
+    Rethrow();
+    return *value_;
+  }
+
+ private:
+  T* value_ = nullptr;
+};
+
+template <>
+class FutureState<void> : public FutureStateBase {
+ public:
+  void SetValue() {
+    Publish();
+  }
+  void value() {
+    Rethrow();
+  }
+};
+
+template <typename T>
+class SharedFuture;
+
+/**
+ * @brief 只能取走一次结果的 Future, 可移动不可拷贝
+ */
+template <typename T>
+class Future {
+ public:
+  Future() = default;
+  explicit Future(std::shared_ptr<FutureState<T> > state)
+      : state_(std::move(state)) {}
+  Future(Future&&) = default;
+  Future& operator=(Future&&) = default;
+  Future(const Future&) = delete;
+  Future& operator=(const Future&) = delete;
+
+  inline bool valid() const {
+    return state_ != nullptr;
+  }
+  inline bool ready() const {
+    return state().ready();
+  }
+  void Wait() const {
+    state().Wait();
+  }
+  bool WaitFor(std::chrono::nanoseconds timeout) const {
+    return state().WaitFor(timeout);
+  }
+
+  /**
+   * @brief 等待并取走结果, 有异常时重新抛出, 之后本 Future 失效
+   * 本 Future 无效或同一状态上的结果已被取走(如对同一任务再次 result().get())时抛出 future_error
+   */
+  T get() {
+    if (!state().Consume()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+    auto state = std::move(state_);
+    state->Wait();
+    if constexpr (std::is_void<T>::value) {
+      state->value();
+    } else if constexpr (std::is_reference<T>::value) {
+      return state->value();
+    } else {
+      return std::move(state->value());
+    }
+  }
+
+  /**
+   * @brief 不阻塞地查询结果, 未就绪返回 nullptr, 有异常时重新抛出; 返回的指针在本 Future 有效期间可用
+   */
+  template <typename U = T, std::enable_if_t<!std::is_void<U>::value, int> = 0>
+  std::add_pointer_t<U> TryGet() {
+    auto& state = Unconsumed();
+    return state.ready() ? &state.value() : nullptr;
+  }
+  /**
+   * @brief 不阻塞地查询, 返回是否已完成, 有异常时重新抛出
+   */
+  template <typename U = T, std::enable_if_t<std::is_void<U>::value, int> = 0>
+  bool TryGet() {
+    auto& state = Unconsumed();
+    if (!state.ready()) {
+      return false;
+    }
+    state.value();
+    return true;
+  }
+
+  /**
+   * @brief 转为可拷贝、可多次取结果的 SharedFuture, 之后本 Future 失效; 结果已被取走时抛出 future_error
+   */
+  SharedFuture<T> Share() {
+    if (!state().Consume()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+    return SharedFuture<T>(std::move(state_));
+  }
+
+ private:
+  /**
+   * @brief 无共享状态(默认构造、已被移动或已取走结果)时抛出 future_error
+   */
+  FutureState<T>& state() const {
+    if (!state_) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+    return *state_;
+  }
+  FutureState<T>& Unconsumed() const {
+    auto& state = this->state();
+    if (state.consumed()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+    return state;
+  }
+
+  std::shared_ptr<FutureState<T> > state_;
+};
+
+/**
+ * @brief 可拷贝的 Future, 所有拷贝读取同一份结果
+ */
+template <typename T>
+class SharedFuture {
+ public:
+  SharedFuture() = default;
+  explicit SharedFuture(std::shared_ptr<FutureState<T> > state)
+      : state_(std::move(state)) {}
+
+  inline bool valid() const {
+    return state_ != nullptr;
+  }
+  inline bool ready() const {
+    return state().ready();
+  }
+  void Wait() const {
+    state().Wait();
+  }
+  bool WaitFor(std::chrono::nanoseconds timeout) const {
+    return state().WaitFor(timeout);
+  }
+
+  /**
+   * @brief 等待并返回结果的引用, 有异常时重新抛出
+   */
+  std::conditional_t<std::is_void<T>::value, void, std::add_lvalue_reference_t<const T> > get() const {
+    state().Wait();
+    return state().value();
+  }
+
+  template <typename U = T, std::enable_if_t<!std::is_void<U>::value, int> = 0>
+  std::add_pointer_t<const U> TryGet() const {
+    return state().ready() ? &state().value() : nullptr;
+  }
+  template <typename U = T, std::enable_if_t<std::is_void<U>::value, int> = 0>
+  bool TryGet() const {
+    if (!state().ready()) {
+      return false;
+    }
+    state().value();
+    return true;
+  }
+
+ private:
+  FutureState<T>& state() const {
+    if (!state_) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+    return *state_;
+  }
+
+  std::shared_ptr<FutureState<T> > state_;
+};
+
+/**
+ * @brief 与 Future 配对的 Promise, 共享状态只分配一次; 未设置结果即析构时以 broken_promise 完成
+ */
+template <typename T>
+class Promise {
+ public:
+  Promise()
+      : state_(std::make_shared<FutureState<T> >()) {}
+  Promise(Promise&&) = default;
+  Promise& operator=(Promise&& other) {
+    if (this != &other) {
+      Abandon();
+      state_ = std::move(other.state_);
+      satisfied_ = other.satisfied_;
+    }
+    return *this;
+  }
+  Promise(const Promise&) = delete;
+  Promise& operator=(const Promise&) = delete;
+  ~Promise() {
+    Abandon();
+  }
+
+  Future<T> GetFuture() {
+    return Future<T>(state_);
+  }
+
+  template <typename ...U>
+  void SetValue(U&&... value) {
+    Satisfy();
+    state_->SetValue(std::forward<U>(value)...);
+  }
+  void SetException(std::exception_ptr error) {
+    Satisfy();
+    state_->SetException(std::move(error));
+  }
+
+ private:
+  void Satisfy() {
+    if (satisfied_) {
+      throw std::future_error(std::future_errc::promise_already_satisfied);
+    }
+    satisfied_ = true;
+  }
+  void Abandon() {
+    if (state_ && !satisfied_) {
+      state_->SetException(std::make_exception_ptr(
+          std::future_error(std::future_errc::broken_promise)));
+    }
+  }
+
+ private:
+  std::shared_ptr<FutureState<T> > state_;
+  bool satisfied_ = false;
+};
+
+} // namespace seeker
+
+#endif // __SEEKER_FUTURE_HPP__
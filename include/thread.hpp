@@ -10,48 +10,198 @@
 #define __SEEKER_THREAD_HPP__
 
 #include <string>
-#include <future>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <functional>
 #include <chrono>
+#include <tuple>
+#include <optional>
+#include <type_traits>
+
+#include "future.hpp"
 
 namespace seeker {
 
-class TaskBase {
+class ThreadPool;
+
+/**
+ * @brief 取消令牌, 拷贝后共享同一状态
+ */
+class CancellationToken {
+ public:
+  CancellationToken()
+      : state_(std::make_shared<std::atomic<bool> >(false)) {}
+
+  /**
+   * @brief 不可取消的空令牌, 不分配状态
+   */
+  static CancellationToken None() {
+    return CancellationToken(nullptr);
+  }
+
+  void Cancel() {
+    if (state_) {
+      state_->store(true);
+    }
+  }
+  inline bool cancelled() const {
+    return state_ && state_->load(std::memory_order_relaxed);
+  }
+
+ private:
+  CancellationToken(std::nullptr_t) {}
+
+ private:
+  std::shared_ptr<std::atomic<bool> > state_;
+};
+
+class TaskBase : public std::enable_shared_from_this<TaskBase> {
  public:
   using Func = std::function<void()>;
   using Ptr = std::shared_ptr<TaskBase>;
 
   TaskBase(std::string name, Func func);
-  ~TaskBase();
+  virtual ~TaskBase();
 
-  std::string name() const;
+  const std::string& name() const;
   time_t start_time() const;
   time_t done_time() const;
+  /**
+   * @brief 入队、开始与完成时的单调时钟纳秒时间戳, 用于计算排队与执行耗时
+   */
+  int64_t enqueue_time_ns() const;
+  int64_t start_time_ns() const;
+  int64_t done_time_ns() const;
+  /**
+   * @brief 执行占用的线程 CPU 时间, 不含其间嵌套执行的其他任务; 线程池未开启 RecordCpuTime 时为 0
+   */
+  int64_t cpu_time_ns() const;
+  /**
+   * @brief 执行期间主动(阻塞等待)与被动(被抢占)的上下文切换次数; 线程池未开启 RecordContextSwitch 时为 0
+   */
+  int64_t voluntary_switches() const;
+  int64_t involuntary_switches() const;
+
+  /**
+   * @brief 驻留任务名, 同名任务共享一份字符串, 任务名应为有限的静态名称
+   */
+  static const std::string* InternName(const std::string& name);
+
+  /**
+   * @brief 注册完成回调, 在完成任务的线程上执行; 若任务已完成则立即执行
+   */
+  void OnDone(std::function<void()> func);
+  bool done() const;
+  /**
+   * @brief 令牌已取消或已超过截止时间, 执行中的任务可轮询以提前结束
+   */
+  bool cancelled() const;
+
+ protected:
+  TaskBase(const std::string* name);
+
+  /**
+   * @brief 执行任务, 子类需在完成结果前调用 Finish
+   */
+  virtual void Run();
+  /**
+   * @brief 任务未执行即被放弃, 子类以 error 完成结果
+   */
+  virtual void Abort(std::exception_ptr error);
+  void Finish();
+
+  inline ThreadPool* pool() const {
+    return pool_;
+  }
 
  private:
-  class Impl;
-  std::unique_ptr<Impl> impl_;
+  /**
+   * @brief 结果已就绪, 依次执行完成回调
+   */
+  void Complete();
+
+ private:
+  const std::string* name_;
+  time_t start_time_ = 0;
+  time_t done_time_ = 0;
+  int64_t enqueue_time_ns_ = 0;
+  int64_t start_time_ns_ = 0;
+  int64_t done_time_ns_ = 0;
+  int64_t cpu_time_ns_ = 0;
+  int64_t voluntary_switches_ = 0;
+  int64_t involuntary_switches_ = 0;
+  CancellationToken token_ = CancellationToken::None();
+  /**
+   * @brief 截止时间的单调时钟纳秒时间戳, 0 表示不限
+   */
+  int64_t deadline_ns_ = 0;
+  /**
+   * @brief 入队时的 ThreadPool::PRIORITY, 后续任务沿用, 默认 NORMAL
+   */
+  int priority_ = 1;
+  Func func_;
+  ThreadPool* pool_ = nullptr;
+  mutable std::mutex mutex_;
+  bool done_ = false;
+  std::vector<std::function<void()> > continuations_;
 
   friend class ThreadPool;
 };
 
+/**
+ * @brief 结果状态内嵌在任务对象中, 不再单独分配
+ */
 template <typename T>
 class Task : public TaskBase {
  public:
   Task(std::string name, Func func)
       : TaskBase(std::move(name), std::move(func)) {}
 
-  std::future<T>& result() {
-    return result_;
+  /**
+   * @brief 结果的 Future, 与任务共享生命周期, 结果只能取走一次
+   */
+  Future<T> result() {
+    return Future<T>(std::shared_ptr<FutureState<T> >(shared_from_this(), &state_));
   }
+
+  /**
+   * @brief 任务完成后将 f(结果) 投递到同一线程池, 不占用等待线程
+   * 会取走本任务的结果, 之后再调用 result().get() 抛出 future_error; 本任务的异常会传递给后续任务
+   */
+  template <class F>
+  auto Then(F&& func);
  protected:
-  void set_result(std::future<T> result) {
-    result_ = std::move(result);
+  Task(const std::string* name)
+      : TaskBase(name) {}
+
+  void Abort(std::exception_ptr error) override {
+    Finish();
+    state_.SetException(error);
+  }
+
+  template <class F>
+  void Invoke(F& func) {
+    try {
+      if constexpr (std::is_void<T>::value) {
+        func();
+        Finish();
+        state_.SetValue();
+      } else {
+        decltype(auto) value = func();
+        Finish();
+        state_.SetValue(std::forward<decltype(value)>(value));
+      }
+    } catch (...) {
+      Finish();
+      state_.SetException(std::current_exception());
+    }
   }
-  friend class ThreadPool;
  private:
-  std::future<T> result_;
+  FutureState<T> state_;
 };
 
 template <typename T>
@@ -60,21 +210,350 @@ class SharedTask : public TaskBase {
   SharedTask(std::string name, Func func)
       : TaskBase(std::move(name), std::move(func)) {}
 
-  std::shared_future<T>& result() {
-    return result_;
+  SharedFuture<T> result() {
+    return SharedFuture<T>(std::shared_ptr<FutureState<T> >(shared_from_this(), &state_));
   }
+
+  /**
+   * @brief 任务完成后将 f(结果) 投递到同一线程池, 可注册多个
+   */
+  template <class F>
+  auto Then(F&& func);
  protected:
-  void set_result(std::future<T>&& result) {
-    result_ = result;
+  SharedTask(const std::string* name)
+      : TaskBase(name) {}
+
+  void Abort(std::exception_ptr error) override {
+    Finish();
+    state_.SetException(error);
   }
-  friend class ThreadPool;
+
+  template <class F>
+  void Invoke(F& func) {
+    try {
+      if constexpr (std::is_void<T>::value) {
+        func();
+        Finish();
+        state_.SetValue();
+      } else {
+        decltype(auto) value = func();
+        Finish();
+        state_.SetValue(std::forward<decltype(value)>(value));
+      }
+    } catch (...) {
+      Finish();
+      state_.SetException(std::current_exception());
+    }
+  }
+ private:
+  FutureState<T> state_;
+};
+
+/**
+ * @brief 线程池内部使用的任务包, 可调用对象与任务对象位于同一次分配中
+ */
+template <class Base, class F>
+class TaskPkg final : public Base {
+ public:
+  TaskPkg(const std::string* name, F&& func)
+      : Base(name),
+        func_(std::move(func)) {}
+
+ protected:
+  void Run() override {
+    if constexpr (std::is_same<Base, TaskBase>::value) {
+      func_();
+      TaskBase::Finish();
+    } else {
+      Base::Invoke(func_);
+    }
+  }
+
  private:
-  std::shared_future<T> result_;
+  F func_;
+};
+
+/**
+ * @brief 耗时直方图的快照, 单位 ns, 对数分桶, 百分位的相对误差不超过 1/16
+ */
+struct HistogramSnapshot {
+  uint64_t Count = 0;
+  uint64_t Sum = 0;
+  uint64_t Max = 0;
+  std::vector<uint64_t> Buckets;
+
+  /**
+   * @brief 百分位数, 如 Percentile(99) 为 p99, 返回所在桶的上界
+   */
+  uint64_t Percentile(double percent) const;
+  double Mean() const;
 };
 
 class ThreadPool {
+ public:
+  using TimerId = uint64_t;
+
+  /**
+   * @brief 调度模式
+   */
+  enum MODE {
+    /**
+     * @brief 所有线程共享一个任务队列
+     */
+    SHARED_QUEUE,
+    /**
+     * @brief 每个线程持有本地双端队列, 外部提交进入注入队列, 空闲线程互相窃取
+     */
+    WORK_STEALING,
+  };
+
+  /**
+   * @brief 线程绑核策略, 只有一个 NUMA 节点时 PIN_NODE 不做绑定
+   */
+  enum AFFINITY {
+    /**
+     * @brief 不绑定, 由系统调度
+     */
+    NO_AFFINITY,
+    /**
+     * @brief 每个线程绑定一个 CPU, 线程按序轮流分配到各 NUMA 节点
+     */
+    PIN_CPU,
+    /**
+     * @brief 每个线程绑定到所在 NUMA 节点的全部 CPU
+     */
+    PIN_NODE,
+  };
+
+  /**
+   * @brief 线程空闲时的等待策略
+   */
+  enum IDLE_POLICY {
+    /**
+     * @brief 立即休眠, 由提交方唤醒
+     */
+    PARK,
+    /**
+     * @brief 先自旋等待一段时间再休眠, 自旋期间提交的任务无需唤醒, 以 CPU 换取延迟
+     */
+    SPIN_THEN_PARK,
+  };
+
+  /**
+   * @brief 队列已满时的处理策略
+   */
+  enum OVERFLOW_POLICY {
+    /**
+     * @brief 阻塞提交方直到队列有空位, 线程池线程提交时改为由提交方执行
+     */
+    BLOCK,
+    /**
+     * @brief 拒绝新任务, 其结果为 RejectedError
+     */
+    REJECT,
+    /**
+     * @brief 由提交方线程直接执行新任务
+     */
+    CALLER_RUNS,
+    /**
+     * @brief 丢弃最低优先级中排队最久的任务, 其结果为 RejectedError
+     */
+    DROP_OLDEST,
+  };
+
+  /**
+   * @brief 队列满时各策略的触发次数
+   */
+  struct OverflowStats {
+    uint64_t Blocked = 0;
+    uint64_t Rejected = 0;
+    uint64_t CallerRuns = 0;
+    uint64_t Dropped = 0;
+  };
+
+  /**
+   * @brief 同名任务的耗时统计
+   */
+  struct TaskStats {
+    std::string Name;
+    /**
+     * @brief 入队到开始执行
+     */
+    HistogramSnapshot QueueWait;
+    /**
+     * @brief 开始执行到完成
+     */
+    HistogramSnapshot RunTime;
+    /**
+     * @brief 执行占用的线程 CPU 时间, 开启 RecordCpuTime 时统计
+     */
+    HistogramSnapshot CpuTime;
+    /**
+     * @brief 上下文切换次数累计, 开启 RecordContextSwitch 时统计
+     */
+    uint64_t VoluntarySwitches = 0;
+    uint64_t InvoluntarySwitches = 0;
+
+    /**
+     * @brief CPU 时间占执行耗时的比例, 接近 1 为计算密集, 接近 0 说明大部分时间在阻塞或等待调度
+     */
+    double CpuRatio() const;
+  };
+
+  /**
+   * @brief 线程正在执行的任务
+   */
+  struct RunningTask {
+    std::string Name;
+    /**
+     * @brief 线程槽位序号
+     */
+    size_t Worker = 0;
+    std::chrono::nanoseconds Age{0};
+  };
+
+  /**
+   * @brief 线程池健康状况快照
+   */
+  struct Health {
+    size_t ThreadNum = 0;
+    /**
+     * @brief 空闲等待任务的线程数
+     */
+    size_t IdleNum = 0;
+    size_t Pending = 0;
+    std::vector<RunningTask> Running;
+    /**
+     * @brief 执行时长超过 StallThreshold 的任务数, 未开启看门狗时为 0
+     */
+    size_t Stalled = 0;
+  };
+
+  /**
+   * @brief 任务优先级, 按 16:4:1 的权重轮转出队
+   */
+  enum PRIORITY {
+    /**
+     * @brief 高优先级, 如配置变更通知
+     */
+    HIGH,
+    /**
+     * @brief 普通
+     */
+    NORMAL,
+    /**
+     * @brief 后台, 如批量日志写入
+     */
+    BACKGROUND,
+  };
+
+  /**
+   * @brief 提交任务时的选项, 可由优先级隐式构造
+   */
+  struct TaskOption {
+    TaskOption(PRIORITY priority = NORMAL)
+        : Priority(priority) {}
+
+    PRIORITY Priority;
+    /**
+     * @brief 取消后排队中的任务不再执行, 结果为 CancelledError
+     */
+    CancellationToken Token = CancellationToken::None();
+    /**
+     * @brief 出队时已超过截止时间的任务不再执行, 结果为 CancelledError
+     */
+    std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::time_point::max();
+  };
+
+  /**
+   * @brief 线程池配置
+   */
+  struct Option {
+    /**
+     * @brief 线程数, 弹性伸缩时为最少线程数
+     */
+    size_t ThreadNum = 1;
+    /**
+     * @brief 调度模式
+     */
+    MODE Mode = SHARED_QUEUE;
+    /**
+     * @brief 最多线程数, 大于 ThreadNum 时开启弹性伸缩
+     */
+    size_t MaxThreadNum = 0;
+    /**
+     * @brief 任务排队超过该时长且没有空闲线程时新增线程
+     */
+    std::chrono::milliseconds SpawnLatency{10};
+    /**
+     * @brief 线程空闲超过该时长后退出, 直到剩下最少线程数
+     */
+    std::chrono::milliseconds IdleTimeout{30000};
+    /**
+     * @brief 绑核策略, 工作窃取模式下存在多个 NUMA 节点时
+     * 外部提交的任务优先交给提交方所在节点的线程, 窃取也优先同节点
+     */
+    AFFINITY Affinity = NO_AFFINITY;
+    /**
+     * @brief 排队任务数上限, 0 表示不限; 并发提交时可能短暂超出
+     */
+    size_t Capacity = 0;
+    /**
+     * @brief 达到上限时的处理策略
+     */
+    OVERFLOW_POLICY Overflow = BLOCK;
+    /**
+     * @brief 按任务名统计排队与执行耗时
+     */
+    bool RecordLatency = true;
+    /**
+     * @brief 以 CLOCK_THREAD_CPUTIME_ID 统计任务占用的 CPU 时间, 每个任务多两次系统调用
+     */
+    bool RecordCpuTime = false;
+    /**
+     * @brief 以 getrusage(RUSAGE_THREAD) 统计任务期间的上下文切换次数, 需开启 RecordCpuTime
+     */
+    bool RecordContextSwitch = false;
+    /**
+     * @brief 空闲策略
+     */
+    IDLE_POLICY Idle = PARK;
+    /**
+     * @brief SPIN_THEN_PARK 下休眠前的自旋时长
+     */
+    std::chrono::microseconds SpinTime{50};
+    /**
+     * @brief 执行阻塞调用时最多补偿的线程数, 0 表示不补偿
+     */
+    size_t MaxBlockingNum = 0;
+    /**
+     * @brief 任务执行超过该时长时由看门狗报告, 0 表示关闭
+     */
+    std::chrono::milliseconds StallThreshold{0};
+    /**
+     * @brief 报告卡住的任务, 每个任务只报告一次, 在定时线程上调用; 为空时输出到标准输出
+     */
+    std::function<void(const RunningTask&)> OnStall;
+  };
+
+  /**
+   * @brief 标记一段会阻塞的代码, 在线程池线程上构造时线程池临时补偿线程, 析构后多出的线程在空闲时退出
+   * 嵌套时只按最外层计数
+   */
+  class BlockingScope {
+   public:
+    BlockingScope();
+    ~BlockingScope();
+    BlockingScope(const BlockingScope&) = delete;
+    BlockingScope& operator=(const BlockingScope&) = delete;
+
+   private:
+    ThreadPool* pool_;
+  };
+
  public:
   ThreadPool(size_t thread_num);
+  ThreadPool(const Option& option);
   ~ThreadPool();
 
   bool Start();
@@ -82,38 +561,850 @@ class ThreadPool {
 
   template <class Func, typename ...Args>
   auto CreateTask(std::string name, Func&& func, Args&&... args) -> std::shared_ptr<Task<decltype(func(args...))> > {
-    return CreateTaskPkg<Task<decltype(func(args...))> >(name,
+    return CreateTaskPkg<Task<decltype(func(args...))> >(NORMAL, name,
+                                                         std::forward<Func>(func), 
+                                                         std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  auto CreateTask(const TaskOption& option, std::string name, Func&& func, Args&&... args) -> std::shared_ptr<Task<decltype(func(args...))> > {
+    return CreateTaskPkg<Task<decltype(func(args...))> >(option, name,
                                                          std::forward<Func>(func), 
                                                          std::forward<Args>(args)...);
   }
 
   template <class Func, typename ...Args>
   auto CreateSharedTask(std::string name, Func&& func, Args&&... args) -> std::shared_ptr<SharedTask<decltype(func(args...))> > {
-    return CreateTaskPkg<SharedTask<decltype(func(args...))> >(name,
+    return CreateTaskPkg<SharedTask<decltype(func(args...))> >(NORMAL, name,
+                                                               std::forward<Func>(func), 
+                                                               std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  auto CreateSharedTask(const TaskOption& option, std::string name, Func&& func, Args&&... args) -> std::shared_ptr<SharedTask<decltype(func(args...))> > {
+    return CreateTaskPkg<SharedTask<decltype(func(args...))> >(option, name,
                                                                std::forward<Func>(func), 
                                                                std::forward<Args>(args)...);
   }
 
+  /**
+   * @brief 提交不关心结果的任务, 不创建 future
+   */
+  template <class Func, typename ...Args>
+  void Post(std::string name, Func&& func, Args&&... args) {
+    CreateTaskPkg<TaskBase>(NORMAL, name, std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  void Post(const TaskOption& option, std::string name, Func&& func, Args&&... args) {
+    CreateTaskPkg<TaskBase>(option, name, std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief 批量创建任务, 对 [first, last) 中的每个元素 e 执行 func(e), 整批一次加锁入队, 最多唤醒 min(n, 空闲线程数) 个线程
+   * 同一批任务连续入队, 按批内顺序出队, 中间不会插入其他同优先级任务; 工作窃取模式下由本池线程提交时进入本地队列,
+   * 本线程按倒序执行, 窃取者按正序取走; 任务可能并行执行, 不保证完成顺序
+   * 设置了队列上限时逐个按溢出策略处理
+   */
+  template <class Iter, class Func>
+  auto CreateTasks(std::string name, Iter first, Iter last, Func&& func) {
+    return CreateTasks(NORMAL, std::move(name), first, last, std::forward<Func>(func));
+  }
+
+  template <class Iter, class Func>
+  auto CreateTasks(const TaskOption& option, std::string name, Iter first, Iter last, Func&& func) {
+    using R = decltype(func(*first));
+    std::vector<std::shared_ptr<Task<R> > > tasks;
+    std::vector<TaskBase::Ptr> batch;
+    for (; first != last; ++first) {
+      auto task = MakeTaskPkg<Task<R> >(name, func, *first);
+      ApplyOption(*task, option);
+      batch.push_back(task);
+      tasks.push_back(std::move(task));
+    }
+    PushBatch(batch, option.Priority);
+    return tasks;
+  }
+
+  /**
+   * @brief 获取某一优先级排队中的任务数
+   */
+  size_t QueueDepth(PRIORITY priority) const;
+  /**
+   * @brief 获取队列满时各策略的触发次数
+   */
+  OverflowStats GetOverflowStats() const;
+  /**
+   * @brief 获取所有任务名的耗时统计快照, 只复制计数器, 不阻塞任务执行
+   */
+  std::vector<TaskStats> GetTaskStats() const;
+  /**
+   * @brief 获取某一任务名的耗时统计快照
+   * @return false 该任务名没有执行记录
+   */
+  bool GetTaskStats(const std::string& name, TaskStats& stats) const;
+  /**
+   * @brief 获取健康状况, 扫描各线程正在执行的任务, 不阻塞任务执行
+   */
+  Health GetHealth() const;
+  /**
+   * @brief 获取运行中的线程数, 未启动时为配置的(最少)线程数
+   */
+  size_t ThreadNum() const;
+  /**
+   * @brief 运行时调整线程数范围, 不足最少线程数时立即补齐, 超出最多线程数的线程执行完当前任务后退出
+   * @param max_num 为 0 时与 min_num 相同, 即固定线程数
+   * @return false 参数非法或超过构造时的线程容量
+   */
+  bool Resize(size_t min_num, size_t max_num = 0);
+  /**
+   * @brief 获取当前线程所属的线程池, 非线程池线程返回 nullptr
+   */
+  static ThreadPool* Current();
+  /**
+   * @brief 获取当前线程正在执行的任务, 可用于在任务内轮询 cancelled()
+   */
+  static TaskBase* CurrentTask();
+  /**
+   * @brief 执行会阻塞的调用(如文件 IO), 期间可用于计算的线程数不减少, 补偿线程数见 Option::MaxBlockingNum
+   * 非线程池线程上直接执行
+   */
+  template <class Func>
+  static decltype(auto) Blocking(Func&& func) {
+    BlockingScope scope;
+    return func();
+  }
+
+  /**
+   * @brief 并行遍历 [begin, end), 调用线程也参与执行, 返回时所有元素均已处理
+   * 分块大小随剩余量自适应递减, 每块不小于 grain, grain 为 0 时自动选择
+   * 首个异常会在调用线程重新抛出, 其余未开始的分块不再执行
+   */
+  template <typename Index, class Func>
+  void ParallelFor(Index begin, Index end, size_t grain, Func&& func) {
+    if (!(begin < end)) {
+      return;
+    }
+    ParallelChunks(static_cast<size_t>(end - begin), grain, [&](size_t first, size_t last) {
+      for (auto i = first; i < last; i++) {
+        func(static_cast<Index>(begin + i));
+      }
+    });
+  }
+
+  /**
+   * @brief 并行归约, func(T acc, Index i) 折叠单个元素, reduce(T, T) 合并部分结果
+   * 部分结果的合并顺序不确定, reduce 需满足结合律与交换律
+   */
+  template <typename Index, typename T, class Func, class Reduce>
+  T ParallelReduce(Index begin, Index end, size_t grain, T identity, Func&& func, Reduce&& reduce) {
+    if (!(begin < end)) {
+      return identity;
+    }
+    std::mutex mutex;
+    T result = identity;
+    ParallelChunks(static_cast<size_t>(end - begin), grain, [&](size_t first, size_t last) {
+      T part = identity;
+      for (auto i = first; i < last; i++) {
+        part = func(std::move(part), static_cast<Index>(begin + i));
+      }
+      std::lock_guard<std::mutex> l(mutex);
+      result = reduce(std::move(result), std::move(part));
+    });
+    return result;
+  }
+
+  /**
+   * @brief 并行归并排序, 两半分别由当前线程与线程池排序, 归并时再按中位元素切分并行归并, 各层都没有串行的整段扫描
+   * 需要与区间等长的临时缓冲, 元素按块并行移入未初始化的缓冲, 不做默认构造; 移动构造可能抛出时退化为 std::sort; 不保证稳定
+   */
+  template <class RandomIt, class Compare>
+  void ParallelSort(RandomIt first, RandomIt last, Compare comp) {
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    auto size = static_cast<size_t>(last - first);
+    auto cutoff = std::max<size_t>(size / (ThreadNum() * 8 + 1), 4096);
+    if constexpr (!std::is_nothrow_move_constructible<T>::value) {
+      std::sort(first, last, comp);
+    } else {
+      if (size <= cutoff) {
+        std::sort(first, last, comp);
+        return;
+      }
+      std::allocator<T> alloc;
+      auto release = [this, size, cutoff, &alloc](T* buffer) {
+        if constexpr (!std::is_trivially_destructible<T>::value) {
+          ParallelChunks(size, cutoff, [buffer](size_t begin, size_t end) {
+            std::destroy(buffer + begin, buffer + end);
+          });
+        }
+        alloc.deallocate(buffer, size);
+      };
+      std::unique_ptr<T, decltype(release)> buffer(alloc.allocate(size), release);
+      ParallelChunks(size, cutoff, [&](size_t begin, size_t end) {
+        std::uninitialized_move(first + begin, first + end, buffer.get() + begin);
+      });
+      // 缓冲作为待排序区间, 原区间作为另一侧, 结果移回原区间
+      ParallelSortImpl(buffer.get(), buffer.get() + size, first, comp, cutoff, true);
+    }
+  }
+
+  template <class RandomIt>
+  void ParallelSort(RandomIt first, RandomIt last) {
+    ParallelSort(first, last, std::less<>());
+  }
+
+  /**
+   * @brief 并行执行两个函数, 第二个投递到线程池, 若返回前仍未被取走则由调用线程执行
+   */
+  void ParallelInvoke(const std::function<void()>& left, const std::function<void()>& right);
+
+  /**
+   * @brief 所有任务完成后完成, 各任务的结果与异常需从任务本身获取
+   */
+  std::shared_ptr<Task<void> > WhenAll(const std::vector<TaskBase::Ptr>& tasks);
+  template <class ...Ts>
+  std::shared_ptr<Task<void> > WhenAll(const std::shared_ptr<Ts>&... tasks) {
+    return WhenAll(std::vector<TaskBase::Ptr>{ tasks... });
+  }
+  /**
+   * @brief 任一任务完成后完成, 结果为最先完成的任务下标
+   */
+  std::shared_ptr<Task<size_t> > WhenAny(const std::vector<TaskBase::Ptr>& tasks);
+  template <class ...Ts>
+  std::shared_ptr<Task<size_t> > WhenAny(const std::shared_ptr<Ts>&... tasks) {
+    return WhenAny(std::vector<TaskBase::Ptr>{ tasks... });
+  }
+
+  /**
+   * @brief 延迟执行, 到期后投递到线程池, 精度为 1ms
+   * @return TimerId 可用于 CancelTimer
+   */
+  TimerId ScheduleAfter(std::chrono::nanoseconds delay, std::function<void()> func);
+  /**
+   * @brief 周期执行, 上一次尚未执行完时跳过本次触发
+   * @return TimerId 可用于 CancelTimer
+   */
+  TimerId ScheduleEvery(std::chrono::nanoseconds period, std::function<void()> func);
+  /**
+   * @brief 取消定时器, 已投递到线程池的任务不受影响
+   */
+  bool CancelTimer(TimerId id);
+
  protected:
- template <typename U, class Func, typename ...Args>
-  auto CreateTaskPkg(std::string name, Func&& func, Args&&... args) {
-    auto bind = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
-    auto pkg_ptr = std::make_shared<std::packaged_task<decltype(func(args...))()> >(bind);
-    auto task = std::make_shared<U>(std::move(name), [pkg_ptr](){
-      (*pkg_ptr)();
+  template <typename U, class Func, typename ...Args>
+  auto CreateTaskPkg(const TaskOption& option, const std::string& name, Func&& func, Args&&... args) {
+    auto task = MakeTaskPkg<U>(name, std::forward<Func>(func), std::forward<Args>(args)...);
+    ApplyOption(*task, option);
+    PushTask(task, option.Priority);
+    return task;
+  }
+
+  /**
+   * @brief 设置任务的取消令牌与截止时间
+   */
+  static void ApplyOption(TaskBase& task, const TaskOption& option) {
+    task.token_ = option.Token;
+    if (option.Deadline != std::chrono::steady_clock::time_point::max()) {
+      task.deadline_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          option.Deadline.time_since_epoch()).count();
+    }
+  }
+
+  /**
+   * @brief 只创建任务, 不投递
+   */
+  template <typename U, class Func, typename ...Args>
+  std::shared_ptr<U> MakeTaskPkg(const std::string& name, Func&& func, Args&&... args) {
+    auto call = [func = std::forward<Func>(func),
+                 args = std::make_tuple(std::forward<Args>(args)...)]() mutable -> decltype(auto) {
+      return std::apply(func, args);
+    };
+    auto task = std::make_shared<TaskPkg<U, decltype(call)> >(TaskBase::InternName(name), std::move(call));
+    task->pool_ = this;
+    return task;
+  }
+
+  void PushTask(TaskBase::Ptr task_ptr, PRIORITY priority = NORMAL);
+  void PushBatch(std::vector<TaskBase::Ptr>& tasks, PRIORITY priority = NORMAL);
+  void ParallelChunks(size_t size, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+  /**
+   * @brief 前驱完成后投递 func(*parent), 没有线程池的前驱在完成它的线程上直接执行
+   */
+  template <typename U, class P, class Func>
+  static std::shared_ptr<U> CreateContinuation(ThreadPool* pool, const std::shared_ptr<P>& parent, Func&& func) {
+    // 前驱完成时才交给后续任务; 前驱永远不完成(如被 Stop 丢弃)时两者之间没有环, 都能释放
+    auto holder = std::make_shared<std::shared_ptr<P> >();
+    auto call = [holder, func = std::forward<Func>(func)]() mutable -> decltype(auto) {
+      auto parent = std::move(*holder);
+      return func(*parent);
+    };
+    auto task = std::make_shared<TaskPkg<U, decltype(call)> >(TaskBase::InternName("Then"), std::move(call));
+    task->pool_ = pool;
+    // 后续任务沿用前驱的取消令牌与截止时间
+    task->token_ = parent->token_;
+    task->deadline_ns_ = parent->deadline_ns_;
+    parent->OnDone([pool, holder, task, weak = std::weak_ptr<P>(parent)](){
+      *holder = weak.lock();
+      if (!pool) {
+        RunInline(task);
+        return;
+      }
+      pool->PushTask(task, static_cast<PRIORITY>((*holder)->priority_));
     });
-    task->set_result(pkg_ptr->get_future());
-    PushTask(std::dynamic_pointer_cast<TaskBase>(task));
     return task;
   }
+  /**
+   * @brief 在当前线程上执行并完成任务, 不经过任何线程池
+   */
+  static void RunInline(const TaskBase::Ptr& task);
+
+  template <typename T>
+  friend class Task;
+  template <typename T>
+  friend class SharedTask;
+  friend class TaskBase;
+  friend class SerialExecutor;
+  friend class Executor;
+  friend class FutureStateBase;
+  friend class TaskGraph;
+  friend class PipelineBase;
+
+  /**
+   * @brief 排序 [first, last), to_buffer 为 true 时结果移入 buffer, 否则留在原区间
+   * 子区间的结果放在另一侧, 本层归并时再移回, 原区间与缓冲交替使用
+   */
+  template <class RandomIt, class BufferIt, class Compare>
+  void ParallelSortImpl(RandomIt first, RandomIt last, BufferIt buffer, Compare& comp, size_t cutoff, bool to_buffer) {
+    auto size = static_cast<size_t>(last - first);
+    if (size <= cutoff) {
+      std::sort(first, last, comp);
+      if (to_buffer) {
+        std::move(first, last, buffer);
+      }
+      return;
+    }
+    auto half = size / 2;
+    auto mid = first + half;
+    ParallelInvoke([&](){ ParallelSortImpl(first, mid, buffer, comp, cutoff, !to_buffer); },
+                   [&](){ ParallelSortImpl(mid, last, buffer + half, comp, cutoff, !to_buffer); });
+    if (to_buffer) {
+      ParallelMerge(first, mid, mid, last, buffer, comp, cutoff);
+    } else {
+      ParallelMerge(buffer, buffer + half, buffer + half, buffer + size, first, comp, cutoff);
+    }
+  }
 
-  void PushTask(TaskBase::Ptr task_ptr);
+  /**
+   * @brief 将两个有序区间移动归并到 out, 较长区间的中位元素在另一区间中二分定位后两侧并行归并
+   */
+  template <class InIt, class OutIt, class Compare>
+  void ParallelMerge(InIt first1, InIt last1, InIt first2, InIt last2, OutIt out, Compare& comp, size_t cutoff) {
+    auto size1 = static_cast<size_t>(last1 - first1);
+    auto size2 = static_cast<size_t>(last2 - first2);
+    if (size1 + size2 <= cutoff) {
+      std::merge(std::make_move_iterator(first1), std::make_move_iterator(last1),
+                 std::make_move_iterator(first2), std::make_move_iterator(last2), out, comp);
+      return;
+    }
+    if (size1 < size2) {
+      std::swap(first1, first2);
+      std::swap(last1, last2);
+      std::swap(size1, size2);
+    }
+    auto mid1 = first1 + size1 / 2;
+    auto mid2 = std::lower_bound(first2, last2, *mid1, comp);
+    auto mid_out = out + (mid1 - first1) + (mid2 - first2);
+    *mid_out = std::move(*mid1);
+    ParallelInvoke([&](){ ParallelMerge(first1, mid1, first2, mid2, out, comp, cutoff); },
+                   [&](){ ParallelMerge(mid1 + 1, last1, mid2, last2, mid_out + 1, comp, cutoff); });
+  }
   
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
 };
 
+class Executor;
+
+/**
+ * @brief 串行执行器, 同一 key 的任务按提交顺序依次执行, 不同 key 之间并行
+ * 不占用线程, 任务仍由线程池执行, 同一 key 同时只有一个任务在线程池中; 空闲的 key 不保留任何状态
+ */
+class SerialExecutor {
+ public:
+  explicit SerialExecutor(ThreadPool& pool);
+  /**
+   * @brief 经由具名执行器投递, 计入其配额
+   */
+  explicit SerialExecutor(Executor& executor);
+  ~SerialExecutor();
+
+  template <class Func, typename ...Args>
+  auto CreateTask(const std::string& key, std::string name, Func&& func, Args&&... args) -> std::shared_ptr<Task<decltype(func(args...))> > {
+    return CreateTask(key, ThreadPool::NORMAL, std::move(name), 
+                      std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  auto CreateTask(const std::string& key, const ThreadPool::TaskOption& option, std::string name, Func&& func, Args&&... args) -> std::shared_ptr<Task<decltype(func(args...))> > {
+    auto task = pool_->MakeTaskPkg<Task<decltype(func(args...))> >(name, std::forward<Func>(func), 
+                                                                   std::forward<Args>(args)...);
+    ThreadPool::ApplyOption(*task, option);
+    Submit(key, option.Priority, task);
+    return task;
+  }
+
+  template <class Func, typename ...Args>
+  void Post(const std::string& key, std::string name, Func&& func, Args&&... args) {
+    Post(key, ThreadPool::NORMAL, std::move(name), std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  void Post(const std::string& key, const ThreadPool::TaskOption& option, std::string name, Func&& func, Args&&... args) {
+    auto task = pool_->MakeTaskPkg<TaskBase>(name, std::forward<Func>(func), std::forward<Args>(args)...);
+    ThreadPool::ApplyOption(*task, option);
+    Submit(key, option.Priority, task);
+  }
+
+  /**
+   * @brief 有任务排队或执行中的 key 数
+   */
+  size_t KeyNum() const;
+  /**
+   * @brief 阻塞至所有 key 的任务执行完, 不应在本执行器的任务中调用
+   */
+  void Wait();
+
+ private:
+  void Submit(const std::string& key, ThreadPool::PRIORITY priority, TaskBase::Ptr task);
+
+ private:
+  class Impl;
+  ThreadPool* pool_;
+  /**
+   * @brief 任务的完成回调持有状态, 执行器先于任务销毁时不影响后续任务
+   */
+  std::shared_ptr<Impl> impl_;
+};
+
+/**
+ * @brief 单个串行队列, 提交的任务按顺序依次执行
+ */
+class Strand {
+ public:
+  explicit Strand(ThreadPool& pool)
+      : executor_(pool) {}
+
+  template <class Func, typename ...Args>
+  auto CreateTask(std::string name, Func&& func, Args&&... args) {
+    return executor_.CreateTask(std::string(), std::move(name), 
+                                std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  auto CreateTask(const ThreadPool::TaskOption& option, std::string name, Func&& func, Args&&... args) {
+    return executor_.CreateTask(std::string(), option, std::move(name), 
+                                std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  void Post(std::string name, Func&& func, Args&&... args) {
+    executor_.Post(std::string(), std::move(name), std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  void Post(const ThreadPool::TaskOption& option, std::string name, Func&& func, Args&&... args) {
+    executor_.Post(std::string(), option, std::move(name), std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief 是否有任务排队或执行中
+   */
+  bool busy() const {
+    return executor_.KeyNum() > 0;
+  }
+
+ private:
+  SerialExecutor executor_;
+};
+
+/**
+ * @brief 共享线程池上的具名执行器, 同时投递到线程池的任务数不超过配额, 超出的在执行器内按优先级排队
+ * 不占用线程, 由 ExecutorRegistry 按名称创建, 同名的使用方共用一份配额与积压上限
+ */
+class Executor {
+ public:
+  using Ptr = std::shared_ptr<Executor>;
+
+  /**
+   * @param quota 同时投递到线程池的任务数上限, 0 表示不限
+   * @param capacity 已提交、尚未完成的任务数上限(含经由其上的串行执行器提交的), 达到上限时提交方阻塞;
+   * 线程池线程与定时器回调中提交时不阻塞. 0 表示不限
+   */
+  Executor(ThreadPool& pool, std::string name, size_t quota, size_t capacity = 0);
+  ~Executor();
+
+  template <class Func, typename ...Args>
+  auto CreateTask(std::string name, Func&& func, Args&&... args) -> std::shared_ptr<Task<decltype(func(args...))> > {
+    return CreateTask(ThreadPool::NORMAL, std::move(name), 
+                      std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  auto CreateTask(const ThreadPool::TaskOption& option, std::string name, Func&& func, Args&&... args) -> std::shared_ptr<Task<decltype(func(args...))> > {
+    auto task = pool_->MakeTaskPkg<Task<decltype(func(args...))> >(name, std::forward<Func>(func), 
+                                                                   std::forward<Args>(args)...);
+    ThreadPool::ApplyOption(*task, option);
+    Submit(option.Priority, task);
+    return task;
+  }
+
+  template <class Func, typename ...Args>
+  void Post(std::string name, Func&& func, Args&&... args) {
+    Post(ThreadPool::NORMAL, std::move(name), std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <class Func, typename ...Args>
+  void Post(const ThreadPool::TaskOption& option, std::string name, Func&& func, Args&&... args) {
+    auto task = pool_->MakeTaskPkg<TaskBase>(name, std::forward<Func>(func), std::forward<Args>(args)...);
+    ThreadPool::ApplyOption(*task, option);
+    Submit(option.Priority, task);
+  }
+
+  /**
+   * @brief 周期执行, 到期后经本执行器投递, 上一次尚未执行完时跳过本次触发
+   */
+  ThreadPool::TimerId ScheduleEvery(std::chrono::nanoseconds period, std::function<void()> func);
+  /**
+   * @brief 取消定时器, 返回时已投递的那次执行也已结束, 之后可安全释放回调引用的对象; 不应在该定时器的回调中调用
+   */
+  bool CancelTimer(ThreadPool::TimerId id);
+
+  const std::string& name() const;
+  size_t quota() const;
+  size_t capacity() const;
+  /**
+   * @brief 已投递到线程池、尚未完成的任务数
+   */
+  size_t running() const;
+  /**
+   * @brief 因配额已满在执行器内排队的任务数
+   */
+  size_t pending() const;
+  inline ThreadPool& pool() const {
+    return *pool_;
+  }
+
+ private:
+  void Submit(ThreadPool::PRIORITY priority, TaskBase::Ptr task);
+
+  friend class SerialExecutor;
+
+ private:
+  class Impl;
+  ThreadPool* pool_;
+  /**
+   * @brief 任务的完成回调持有状态, 执行器先于任务销毁时不影响后续任务
+   */
+  std::shared_ptr<Impl> impl_;
+};
+
+/**
+ * @brief 进程内共享的执行器注册表, 各子系统按名称借用执行器, 不再各自创建线程
+ * 所有执行器共用一个线程池, 线程数随负载在 1 到 CPU 核数之间伸缩, 阻塞调用另有同样数量的补偿线程
+ */
+class ExecutorRegistry {
+ public:
+  /**
+   * @brief 进程内唯一实例, 有意不析构, 退出时仍在投递任务的静态对象不受析构顺序影响
+   */
+  static ExecutorRegistry& GetInstance();
+
+  /**
+   * @brief 获取具名执行器, 首次获取时以 quota 与 capacity 创建, 之后传入的被忽略
+   * @param quota 同时投递到线程池的任务数上限, 0 表示不限
+   * @param capacity 积压任务数上限, 见 Executor, 0 表示不限
+   */
+  Executor::Ptr Get(const std::string& name, size_t quota = 0, size_t capacity = 0);
+  /**
+   * @brief 已创建的全部执行器
+   */
+  std::vector<Executor::Ptr> List() const;
+  ThreadPool& pool();
+
+ private:
+  ExecutorRegistry();
+  ~ExecutorRegistry();
+  ExecutorRegistry(const ExecutorRegistry&) = delete;
+  ExecutorRegistry& operator=(const ExecutorRegistry&) = delete;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief 任务依赖图, 节点在所有前驱完成后立即投递到线程池, 如 加载配置 → 创建日志 → 启动服务
+ * 图可重复运行, 运行期间不应再添加节点或边
+ */
+class TaskGraph {
+ public:
+  using NodeId = size_t;
+
+  /**
+   * @brief 节点在一次运行中的时间, 相对运行开始, 单位 ns
+   */
+  struct NodeReport {
+    std::string Name;
+    int64_t Start = 0;
+    int64_t Done = 0;
+    /**
+     * @brief 因其他节点出错未执行
+     */
+    bool Skipped = false;
+  };
+
+  /**
+   * @brief 一次运行的耗时报告
+   */
+  struct Report {
+    int64_t Total = 0;
+    /**
+     * @brief 关键路径, 从最后完成的节点起逐步取最晚完成的前驱, 按执行顺序排列
+     */
+    std::vector<NodeId> CriticalPath;
+    /**
+     * @brief 关键路径上节点的执行耗时之和, 与 Total 的差为排队与调度开销
+     */
+    int64_t CriticalRunTime = 0;
+    std::vector<NodeReport> Nodes;
+
+    std::string ToString() const;
+  };
+
+ public:
+  explicit TaskGraph(ThreadPool& pool);
+  ~TaskGraph();
+
+  NodeId AddNode(std::string name, std::function<void()> func,
+                 ThreadPool::PRIORITY priority = ThreadPool::NORMAL);
+  /**
+   * @brief to 在 from 完成后执行
+   * @return false 节点不存在或会形成环
+   */
+  bool AddEdge(NodeId from, NodeId to);
+  size_t NodeNum() const;
+
+  /**
+   * @brief 运行一次, 所有节点结束后返回的任务完成
+   * 节点出错或未被线程池执行时不再执行尚未开始的节点, 返回的任务以首个异常结束
+   */
+  std::shared_ptr<Task<void> > Run();
+  /**
+   * @brief 获取最近一次结束的运行的报告
+   * @return false 还没有运行结束过
+   */
+  bool GetReport(Report& report) const;
+
+ private:
+  class Impl;
+  /**
+   * @brief 运行中的节点任务持有状态, 图先于运行结束销毁时不受影响
+   */
+  std::shared_ptr<Impl> impl_;
+};
+
+/**
+ * @brief 流水线的调度部分, 与数据类型无关, 数据以槽位序号表示
+ */
+class PipelineBase {
+ public:
+  /**
+   * @brief 阶段的并发方式
+   */
+  enum MODE {
+    /**
+     * @brief 同一时刻只处理一个数据, 不保证顺序
+     */
+    SERIAL,
+    /**
+     * @brief 同一时刻只处理一个数据, 按提交顺序处理
+     */
+    IN_ORDER,
+    /**
+     * @brief 并行处理, 可限制并发数
+     */
+    PARALLEL,
+  };
+
+  /**
+   * @brief 阶段统计, 时间单位 ns, 速率按流水线创建以来的时长计算
+   */
+  struct StageStats {
+    std::string Name;
+    uint64_t Processed = 0;
+    /**
+     * @brief 返回 false 或抛出异常而丢弃的数据数
+     */
+    uint64_t Dropped = 0;
+    uint64_t Errors = 0;
+    size_t Running = 0;
+    /**
+     * @brief 在阶段前排队的数据数
+     */
+    size_t Buffered = 0;
+    size_t MaxBuffered = 0;
+    uint64_t BusyTime = 0;
+    /**
+     * @brief 每秒处理的数据数
+     */
+    double Throughput = 0;
+    /**
+     * @brief 平均同时处理的数据数, 串行阶段为忙碌时间占比
+     */
+    double Occupancy = 0;
+  };
+
+ public:
+  /**
+   * @brief 同时在流水线中的数据数不超过 capacity, 各阶段前的缓冲也因此有界
+   */
+  PipelineBase(ThreadPool& pool, size_t capacity);
+  virtual ~PipelineBase();
+
+  /**
+   * @brief 阻塞至已提交的数据全部流出
+   */
+  void Wait();
+  /**
+   * @brief 流水线中的数据数
+   */
+  size_t Size() const;
+  std::vector<StageStats> GetStats() const;
+
+ protected:
+  void AddStageImpl(std::string name, MODE mode, size_t parallelism, std::function<bool(size_t)> func);
+  /**
+   * @brief 获取空闲槽位, 流水线已满时 wait 为 true 则阻塞等待
+   */
+  bool Acquire(size_t& slot, bool wait);
+  /**
+   * @brief 槽位中的数据已就绪, 进入第一个阶段
+   */
+  void Submit(size_t slot);
+  /**
+   * @brief 数据流出流水线, 释放槽位中的数据
+   */
+  virtual void Release(size_t slot) = 0;
+
+ private:
+  class Impl;
+  /**
+   * @brief 阶段任务持有状态, 最后一个数据流出后任务仍可能在收尾
+   */
+  std::shared_ptr<Impl> impl_;
+};
+
+/**
+ * @brief 有界多阶段流水线, 如 解析 → 补全 → 格式化 → 写入
+ * 线程池线程处理完一个阶段后直接带着数据进入下一阶段, 不重新入队; 下一阶段忙时数据在其缓冲中等待,
+ * 阶段空出后由完成的线程投递. 阶段函数返回 false 时丢弃数据, 后续 IN_ORDER 阶段的顺序不受影响
+ * 应在提交数据前添加所有阶段, 线程池线程上提交应使用 TryPush 避免阻塞
+ */
+template <typename T>
+class Pipeline : public PipelineBase {
+ public:
+  using Func = std::function<bool(T&)>;
+
+  Pipeline(ThreadPool& pool, size_t capacity)
+      : PipelineBase(pool, capacity),
+        items_(capacity) {}
+  ~Pipeline() {
+    Wait();
+  }
+
+  /**
+   * @brief 添加阶段, parallelism 只对 PARALLEL 有效, 0 表示不限
+   */
+  Pipeline& AddStage(std::string name, MODE mode, Func func, size_t parallelism = 0) {
+    AddStageImpl(std::move(name), mode, parallelism, [this, func = std::move(func)](size_t slot) {
+      return func(*items_[slot]);
+    });
+    return *this;
+  }
+
+  /**
+   * @brief 提交数据, 流水线已满时阻塞
+   */
+  void Push(T item) {
+    size_t slot;
+    Acquire(slot, true);
+    items_[slot].emplace(std::move(item));
+    Submit(slot);
+  }
+  /**
+   * @brief 提交数据, 流水线已满时返回 false, 数据保持不变
+   */
+  bool TryPush(T& item) {
+    size_t slot;
+    if (!Acquire(slot, false)) {
+      return false;
+    }
+    items_[slot].emplace(std::move(item));
+    Submit(slot);
+    return true;
+  }
+
+ protected:
+  void Release(size_t slot) override {
+    items_[slot].reset();
+  }
+
+ private:
+  std::vector<std::optional<T> > items_;
+};
+
+template <typename T>
+template <class F>
+auto Task<T>::Then(F&& func) {
+  auto parent = std::static_pointer_cast<Task<T> >(shared_from_this());
+  if constexpr (std::is_void<T>::value) {
+    using R = decltype(func());
+    return ThreadPool::CreateContinuation<Task<R> >(this->pool(), parent,
+        [func = std::forward<F>(func)](auto& parent) mutable -> decltype(auto) {
+          parent.result().get();
+          return func();
+        });
+  } else {
+    using R = decltype(func(std::declval<T>()));
+    return ThreadPool::CreateContinuation<Task<R> >(this->pool(), parent,
+        [func = std::forward<F>(func)](auto& parent) mutable -> decltype(auto) {
+          return func(parent.result().get());
+        });
+  }
+}
+
+template <typename T>
+template <class F>
+auto SharedTask<T>::Then(F&& func) {
+  auto parent = std::static_pointer_cast<SharedTask<T> >(shared_from_this());
+  if constexpr (std::is_void<T>::value) {
+    using R = decltype(func());
+    return ThreadPool::CreateContinuation<Task<R> >(this->pool(), parent,
+        [func = std::forward<F>(func)](auto& parent) mutable -> decltype(auto) {
+          parent.result().get();
+          return func();
+        });
+  } else {
+    using R = decltype(func(std::declval<const T&>()));
+    return ThreadPool::CreateContinuation<Task<R> >(this->pool(), parent,
+        [func = std::forward<F>(func)](auto& parent) mutable -> decltype(auto) {
+          return func(parent.result().get());
+        });
+  }
+}
+
 } // namespace seeker
 
 #endif // __SEEKER_THREAD_HPP__
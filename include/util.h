@@ -11,6 +11,7 @@
 
 #include <unistd.h>
 #include <chrono>
+#include <thread>
 
 namespace seeker {
 namespace util {
@@ -24,6 +25,27 @@ inline static time_t GetCurTimeStamp() {
 	return timestamp;
 }
 
+/**
+ * @brief 获取单调时钟纳秒时间戳, 用于计算耗时
+ */
+inline static int64_t GetSteadyTimeNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 自旋等待时降低功耗并让出流水线给同核的超线程
+ */
+inline static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield" ::: "memory");
+#else
+	std::this_thread::yield();
+#endif
+}
+
 } // namespace util
 } // namespace seeker
 
@@ -7,7 +7,9 @@
 namespace seeker {
 Cfg::Impl::Impl(size_t th_nums)
     : start_(false),
-      th_(std::make_unique<seeker::ThreadPool>(th_nums)) {}
+      executor_(ExecutorRegistry::GetInstance().Get("cfg", th_nums)),
+      serial_(std::make_unique<seeker::SerialExecutor>(*executor_)),
+      flush_pending_(false) {}
 
 Cfg::Impl::~Impl() {
   Deinit();
@@ -18,24 +20,18 @@ bool Cfg::Impl::Init(std::initializer_list<Meta>&& list) {
     return true;
   }
   std::lock_guard<std::mutex> l(mutex_);
-  th_->Start();
-  
   std::vector<Meta> meta = list;
   ReadFile(meta);
 
   start_ = true;
-  writer_ = std::thread(&Cfg::Impl::WriterThread, this);
 
   return true;
 }
 
 void Cfg::Impl::Deinit() {
-  if (!start_) {
-    return;
-  }
-  th_->Stop();
+  // 执行器是共享的, 需等本实例的写入与通知都结束后才能释放
   start_ = false;
-  writer_.join();
+  serial_->Wait();
 }
 
 bool Cfg::Impl::Query(const std::string& cfg_name, const std::string& key, nlohmann::json& value) {
@@ -49,13 +45,16 @@ bool Cfg::Impl::Query(const std::string& cfg_name, const std::string& key, nlohm
 }
 
 bool Cfg::Impl::Append(const std::string& cfg_name, const std::string& key, nlohmann::json& value) {
-  std::lock_guard<std::mutex> l(mutex_);
-  auto cfg = jsons_.find(cfg_name);
-  if (cfg == jsons_.end()) {
-    return false;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto cfg = jsons_.find(cfg_name);
+    if (cfg == jsons_.end()) {
+      return false;
+    }
+    cfg->second.Data[key] = value;
+    cfg->second.Changed = true;
   }
-  cfg->second.Data[key] = value;
-  cfg->second.Changed = true;
+  ScheduleFlush();
   return true;
 }
 
@@ -63,7 +62,7 @@ bool Cfg::Impl::Update(const std::string& cfg_name, const std::string& key, cons
   auto func = std::bind(&Cfg::Impl::UpdateTask, this, 
                         std::placeholders::_1, std::placeholders::_2, 
                         std::placeholders::_3);
-  th_->CreateTask("notifyCfg", func, cfg_name, key, value);
+  serial_->Post(cfg_name + "/" + key, ThreadPool::HIGH, "notifyCfg", func, cfg_name, key, value);
   return true;
 }
 
@@ -129,6 +128,18 @@ bool Cfg::Impl::ReadFile(std::vector<Meta>& list) {
   return true;
 }
 
+void Cfg::Impl::ScheduleFlush() {
+  // 已有待执行的写入时合并到其中, 只有配置变更时才写文件
+  if (flush_pending_.exchange(true)) {
+    return;
+  }
+  serial_->Post("", ThreadPool::BACKGROUND, "flushCfg", [this](){
+    std::lock_guard<std::mutex> l(mutex_);
+    flush_pending_ = false;
+    WriteFile();
+  });
+}
+
 bool Cfg::Impl::WriteFile() {
   for (auto& i : jsons_) {
     if (!i.second.Changed) {
@@ -148,40 +159,32 @@ bool Cfg::Impl::WriteFile() {
   return true;
 }
 
-// TODO: Modify In Future
-void Cfg::Impl::WriterThread() {
-  while (start_) {
-    {
-      std::lock_guard<std::mutex> l(mutex_);
-      WriteFile();
-    }
-    usleep(500);
-  }
-}
-
 void Cfg::Impl::UpdateTask(const std::string cfg_name, const std::string key, const nlohmann::json value) {
-  std::lock_guard<std::mutex> l(mutex_);
-  std::unordered_map<std::string, JsonMeta>::iterator cfg;
-  nlohmann::json::iterator json;
-  if (!CheckExist(cfg_name, key, cfg, json)) {
-    return;
-  }
-  bool need_revert = false;
-  for (auto& i : listeners_[key]) {
-    if (!i.CallBack(json.value(), value)) {
-      need_revert = true;
-      break;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    std::unordered_map<std::string, JsonMeta>::iterator cfg;
+    nlohmann::json::iterator json;
+    if (!CheckExist(cfg_name, key, cfg, json)) {
+      return;
     }
-  }
-  // revert cfg
-  if (need_revert) {
+    bool need_revert = false;
     for (auto& i : listeners_[key]) {
-      i.CallBack(value, json.value());
+      if (!i.CallBack(json.value(), value)) {
+        need_revert = true;
+        break;
+      }
+    }
+    // revert cfg
+    if (need_revert) {
+      for (auto& i : listeners_[key]) {
+        i.CallBack(value, json.value());
+      }
+      return;
     }
-  } else {
     cfg->second.Data[key] = value;
     cfg->second.Changed = true;
   }
+  ScheduleFlush();
 }
 
 Cfg::Cfg(size_t th_size)
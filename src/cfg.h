@@ -10,6 +10,7 @@
 #define __SEEKER_SRC_CFG__
 
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <memory>
@@ -50,9 +51,11 @@ class Cfg::Impl {
                   std::unordered_map<std::string, JsonMeta>::iterator& cfg,
                   nlohmann::json::iterator& json);
   bool ReadFile(std::vector<Meta>& list);
+  /**
+   * @brief 配置变更后投递一次写入, 不在持有 mutex_ 时调用
+   */
+  void ScheduleFlush();
   bool WriteFile();
-  // TODO: Modify In Future
-  void WriterThread();
 
   void UpdateTask(const std::string cfg_name, const std::string key, const nlohmann::json value);
  private:
@@ -60,9 +63,18 @@ class Cfg::Impl {
   std::mutex mutex_;
   std::unordered_map<std::string, std::vector<Listener> > listeners_;
   std::unordered_map<std::string, JsonMeta> jsons_;
-  std::unique_ptr<seeker::ThreadPool> th_;
-  // TODO: Modify In Future
-  std::thread writer_;
+  /**
+   * @brief 所有配置实例共用的 "cfg" 执行器, 配额为首个实例的线程数
+   */
+  seeker::Executor::Ptr executor_;
+  /**
+   * @brief 同一配置项的更新按提交顺序依次通知
+   */
+  std::unique_ptr<seeker::SerialExecutor> serial_;
+  /**
+   * @brief 已投递、尚未开始的写入, 其间的变更由它一并写出
+   */
+  std::atomic<bool> flush_pending_;
 };
 
 } // namespace seeker
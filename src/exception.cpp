@@ -52,4 +52,32 @@ OtherError OtherError::Create(std::string module_name,
 OtherError::OtherError(std::string str) 
     : Exception(str) {};
 
+RejectedError RejectedError::Create(std::string module_name, 
+                                    std::string explanatory_str,
+                                    int32_t erro_num) {
+  std::ostringstream oss;
+  oss << "rejectedError(" << module_name << "): "
+      << explanatory_str;
+  if (erro_num)
+    oss << ", errno: " << std::strerror(erro_num);
+  return { oss.str() };
+}
+
+RejectedError::RejectedError(std::string str) 
+    : Exception(str) {};
+
+CancelledError CancelledError::Create(std::string module_name, 
+                                      std::string explanatory_str,
+                                      int32_t erro_num) {
+  std::ostringstream oss;
+  oss << "cancelledError(" << module_name << "): "
+      << explanatory_str;
+  if (erro_num)
+    oss << ", errno: " << std::strerror(erro_num);
+  return { oss.str() };
+}
+
+CancelledError::CancelledError(std::string str) 
+    : Exception(str) {};
+
 } // seeker
\ No newline at end of file
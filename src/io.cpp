@@ -21,8 +21,9 @@ bool Manager::GetService(TYPE type, Service::WPtr& wptr) {
 void Manager::InitService() {
   std::lock_guard<std::mutex> l(mutex_);
   // TODO: Support More...
-  auto ptr = std::make_shared<Service>(3);
-  ptr->Start();
+  // IO 负载突发, 最多同时占用 3 个线程; 文件读写在阻塞区内执行, 由共享线程池补偿线程
+  // 磁盘卡顿时积压达到上限后阻塞写日志的线程, 避免任务无限堆积
+  auto ptr = std::make_shared<Service>(ExecutorRegistry::GetInstance().Get("io", 3, 65536));
   service_.insert({TINY_FILE_SERVICE, ptr});
 }
 
@@ -21,14 +21,32 @@ namespace io {
 class Manager {
  public:
   
-  class Service : public seeker::ThreadPool {
+  /**
+   * @brief IO 服务, 借用共享线程池上的具名执行器, 不再持有线程
+   */
+  class Service {
    public:
     using Ptr = std::shared_ptr<Service>;
     using WPtr = std::weak_ptr<Service>;
 
-    Service(size_t thread_num)
-        : seeker::ThreadPool(thread_num) {}
+    explicit Service(seeker::Executor::Ptr executor)
+        : executor_(std::move(executor)),
+          serial_(*executor_) {}
     ~Service() = default;
+
+    inline seeker::Executor& executor() {
+      return *executor_;
+    }
+    /**
+     * @brief 按 key 串行执行, 如同一文件的写入按提交顺序落盘
+     */
+    inline seeker::SerialExecutor& serial() {
+      return serial_;
+    }
+
+   private:
+    seeker::Executor::Ptr executor_;
+    seeker::SerialExecutor serial_;
   };
 
  public:
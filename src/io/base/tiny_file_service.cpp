@@ -13,6 +13,7 @@ TinyFileService::TinyFileService(std::string path)
 TinyFileService::~TinyFileService() = default;
 
 TinyFileService::RESULT TinyFileService::ReadImpl(std::stringstream& ss) {
+  ThreadPool::BlockingScope blocking;
   auto res = FileCanBeRead();
   if (res) {
     return res;
@@ -31,6 +32,7 @@ TinyFileService::RESULT TinyFileService::ReadImpl(std::stringstream& ss) {
 }
 
 TinyFileService::RESULT TinyFileService::WriteImpl(std::string str, bool append) {
+  ThreadPool::BlockingScope blocking;
   auto res = FileCanBeWrite();
   if (res == NO_WRITE) {
     return res;
@@ -34,6 +34,9 @@ class TinyFileService {
  protected:
   RESULT ReadImpl(std::stringstream& ss);
   RESULT WriteImpl(std::string str, bool append = false);
+  inline const std::string& path() const {
+    return path_;
+  }
   
  private:
   RESULT FileCanBeRead();
@@ -26,7 +26,9 @@ class FileService : protected base::TinyFileService {
     io::Mgr::GetInstance().GetService(io::Manager::TINY_FILE_SERVICE, service);
     if (!service.expired()) {
       auto str = oss.str();
-      service.lock()->CreateTask("UpdateLog", [=](){ WriteImpl(str, true); });
+      // 同一文件的写入串行执行, 保证按提交顺序落盘
+      service.lock()->serial().Post(path(), ThreadPool::BACKGROUND, "UpdateLog", 
+                                    [=](){ WriteImpl(str, true); });
     }
   }
 };
@@ -21,7 +21,9 @@ IHttpService::METHOD GetMethod(struct mg_str* src) {
 
 MongooseService::MongooseService() = default;
 
-MongooseService::~MongooseService() = default;
+MongooseService::~MongooseService() {
+  Stop();
+}
 
 bool MongooseService::Start(uint16_t port) {
   if (start_) {
@@ -46,7 +48,9 @@ bool MongooseService::Start(uint16_t port) {
 }
 
 void MongooseService::Stop() {
-  start_ = false;
+  if (!start_.exchange(false)) {
+    return;
+  }
   msg_loop_.join();
 }
 
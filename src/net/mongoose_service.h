@@ -10,6 +10,7 @@
 #define __SEEKER_SRC_NET_MONGOOSE_SERVICE_H__
 
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <memory>
 #include <string>
@@ -43,12 +44,15 @@ class MongooseService : public base::HttpServiceBase {
                             void *ev_data, void *fn_data);
 
  private:
-  bool start_ = false;
+  std::atomic<bool> start_{false};
 
   struct mg_mgr mgr_;
   std::string web_dir_;
   std::map<void* , std::string> file_r_;
 
+  /**
+   * @brief 轮询在服务运行期间一直阻塞, 使用独立线程而不占用共享线程池的线程
+   */
   std::thread msg_loop_;
 };
 #endif
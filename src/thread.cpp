@@ -1,132 +1,1926 @@
 #include "thread.h"
 
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
+
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "log.h"
 #include "util.h"
 
 #define DEFAULT_THREAD_NAME    "UNKNOWN"
+#define MAX_HELP_DEPTH         64
 
 namespace seeker {
 
-TaskBase::Impl::Impl(std::string name, Func func)
-    : name_(std::move(name)),
-      func_(std::move(func)) {}
-
-TaskBase::Impl::~Impl() = default;
+static const char* MODULE_NAME = "seeker::thread";
 
 TaskBase::TaskBase(std::string name, Func func)
-    : impl_(std::make_unique<TaskBase::Impl>(std::move(name), std::move(func))) {}
+    : name_(InternName(name)),
+      func_(std::move(func)) {}
+
+TaskBase::TaskBase(const std::string* name)
+    : name_(name) {}
 
 TaskBase::~TaskBase() = default;
 
-std::string TaskBase::name() const {
-  return impl_->name();
+const std::string& TaskBase::name() const {
+  return *name_;
 }
 
 time_t TaskBase::start_time() const {
-  return impl_->start_time();
+  return start_time_;
 }
 
 time_t TaskBase::done_time() const {
-  return impl_->done_time();
+  return done_time_;
+}
+
+int64_t TaskBase::enqueue_time_ns() const {
+  return enqueue_time_ns_;
+}
+
+int64_t TaskBase::start_time_ns() const {
+  return start_time_ns_;
+}
+
+int64_t TaskBase::done_time_ns() const {
+  return done_time_ns_;
+}
+
+int64_t TaskBase::cpu_time_ns() const {
+  return cpu_time_ns_;
+}
+
+int64_t TaskBase::voluntary_switches() const {
+  return voluntary_switches_;
+}
+
+int64_t TaskBase::involuntary_switches() const {
+  return involuntary_switches_;
+}
+
+const std::string* TaskBase::InternName(const std::string& name) {
+  static std::mutex mutex;
+  static std::unordered_set<std::string> names;
+  // 线程本地缓存, 命中时不需要加锁
+  thread_local std::unordered_map<std::string, const std::string*> cache;
+  auto res = cache.find(name);
+  if (res != cache.end()) {
+    return res->second;
+  }
+  const std::string* interned;
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    interned = &(*names.insert(name).first);
+  }
+  cache.emplace(name, interned);
+  return interned;
+}
+
+void TaskBase::OnDone(std::function<void()> func) {
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!done_) {
+      continuations_.push_back(std::move(func));
+      return;
+    }
+  }
+  func();
+}
+
+bool TaskBase::cancelled() const {
+  return token_.cancelled() || (deadline_ns_ != 0 && util::GetSteadyTimeNs() > deadline_ns_);
+}
+
+bool TaskBase::done() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return done_;
+}
+
+void TaskBase::Complete() {
+  std::vector<std::function<void()> > continuations;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    done_ = true;
+    continuations.swap(continuations_);
+  }
+  for (auto& func : continuations) {
+    func();
+  }
+}
+
+void TaskBase::Run() {
+  if (func_) {
+    func_();
+  }
+  Finish();
+}
+
+void TaskBase::Abort(std::exception_ptr error) {
+  Finish();
 }
 
-ThreadPool::Impl::Impl(size_t thread_num)
-    : started_(false), 
-      thread_num_(thread_num) {}
+void TaskBase::Finish() {
+  done_time_ns_ = util::GetSteadyTimeNs();
+  done_time_ = util::GetCurTimeStamp();
+  ThreadPool::Impl::EndCpuSample(this);
+}
+
+thread_local ThreadPool::Impl::Worker* ThreadPool::Impl::current_ = nullptr;
+thread_local ThreadPool* ThreadPool::Impl::current_pool_ = nullptr;
+thread_local TaskBase* ThreadPool::Impl::current_task_ = nullptr;
+thread_local size_t ThreadPool::Impl::help_depth_ = 0;
+thread_local size_t ThreadPool::Impl::blocking_depth_ = 0;
+thread_local ThreadPool::Impl::CpuFrame* ThreadPool::Impl::cpu_frame_ = nullptr;
+
+ThreadPool::Impl::Impl(ThreadPool* owner, const Option& option)
+    : owner_(owner),
+      started_(false), 
+      mode_(option.Mode),
+      capacity_(std::max(option.ThreadNum, option.MaxThreadNum) + option.MaxBlockingNum),
+      min_num_(option.ThreadNum),
+      max_num_(std::max(option.ThreadNum, option.MaxThreadNum)),
+      max_blocking_(option.MaxBlockingNum),
+      spawn_latency_(option.SpawnLatency),
+      idle_timeout_(option.IdleTimeout),
+      stall_threshold_(option.StallThreshold),
+      on_stall_(option.OnStall),
+      affinity_(option.Affinity),
+      queue_capacity_(option.Capacity),
+      overflow_(option.Overflow),
+      record_latency_(option.RecordLatency),
+      record_cpu_(option.RecordCpuTime),
+      record_switches_(option.RecordCpuTime && option.RecordContextSwitch),
+      idle_policy_(option.Idle),
+      spin_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(option.SpinTime).count()) {}
 
 ThreadPool::Impl::~Impl() {
   Stop();
 }
 
 bool ThreadPool::Impl::Start() {
-  std::lock_guard<std::mutex> l(mutex_);
+  std::lock_guard<std::mutex> rl(resize_mutex_);
   if (started_) {
     return true;
   }
   started_ = true;
-  std::atomic<size_t> count{0};
-  for (auto i = 0; i < thread_num_; i++)  {
-    try {
-      auto thread = std::thread([&](){
-        count.fetch_add(1);
-        Loop();
-      });
-      threads_.push_back(std::move(thread));
-    } catch(const std::system_error& e) {
-      std::cout << "Caught system_error with code "
-                   "[" << e.code() << "] meaning "
-                   "[" << e.what() << "]\n";
-      --thread_num_;
-    }
-  }
-  while (count.load() != thread_num_) {}
-  return true;
+  for (size_t i = 0; i < capacity_; i++) {
+    workers_.emplace_back(new Worker);
+    workers_.back()->Owner = this;
+    workers_.back()->Index = i;
+  }
+  PlaceWorkers();
+  last_pop_ns_ = util::GetSteadyTimeNs();
+  while (active_num_.load() < min_num_.load() && Spawn()) {}
+  // 阻塞期间新到的任务也由监控线程按排队时长补偿
+  if (max_num_.load() > min_num_.load() || max_blocking_ > 0) {
+    StartMonitor();
+  }
+  if (stall_threshold_.count() > 0) {
+    auto period = std::max<std::chrono::nanoseconds>(stall_threshold_ / 2, std::chrono::milliseconds(1));
+    timer_.Add(period, period, [this](){
+      CheckStall();
+    });
+  }
+  return active_num_.load() > 0;
 }
 
 void ThreadPool::Impl::Stop() {
+  timer_.Stop();
   {
     std::lock_guard<std::mutex> l(mutex_);
     started_ = false;
     cv_.notify_all();
+    full_cv_.notify_all();
   }
 
-  int index = 0;
-  for (auto& thread : threads_) {
-    if (thread.joinable()) {
-      thread.join();
+  // 在锁外等待线程退出, 任务中进入阻塞区域或查询线程池时会获取 resize_mutex_
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> rl(resize_mutex_);
+    for (auto& worker : workers_) {
+      if (worker->Thread.joinable()) {
+        threads.push_back(std::move(worker->Thread));
+      }
     }
   }
-  std::lock_guard<std::mutex> l(mutex_);
-  threads_.clear();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<TaskBase::Ptr> discarded;
+  {
+    std::lock_guard<std::mutex> rl(resize_mutex_);
+    std::lock_guard<std::mutex> l(mutex_);
+    // 共享队列、本地队列与节点队列中未执行的任务随工作线程一起丢弃
+    TaskBase::Ptr task;
+    PRIORITY priority;
+    while (tasks_.Pop(task, priority)) {
+      depth_[priority].fetch_sub(1);
+      pending_.fetch_sub(1);
+      discarded.push_back(std::move(task));
+    }
+    for (auto& worker : workers_) {
+      depth_[NORMAL].fetch_sub(worker->Tasks.size());
+      pending_.fetch_sub(worker->Tasks.size());
+      for (auto& task : worker->Tasks) {
+        discarded.push_back(std::move(task));
+      }
+    }
+    for (auto& queue : node_tasks_) {
+      while (queue->Tasks.Pop(task, priority)) {
+        depth_[priority].fetch_sub(1);
+        pending_.fetch_sub(1);
+        discarded.push_back(std::move(task));
+      }
+    }
+    workers_.clear();
+    node_tasks_.clear();
+    active_num_ = 0;
+    monitor_ = 0;
+  }
+  // 在锁外放弃, 完成回调(如恢复协程、释放配额)可能再次投递
+  for (auto& task : discarded) {
+    Abort(task, std::make_exception_ptr(CancelledError::Create(MODULE_NAME, 
+                                                               "task [" + task->name() + "] discarded as pool stopped")));
+  }
 }
 
-void ThreadPool::Impl::PushTask(TaskBase::Ptr&& task) {
+bool ThreadPool::Impl::Resize(size_t min_num, size_t max_num) {
+  if (max_num == 0) {
+    max_num = min_num;
+  }
+  if (min_num == 0 || min_num > max_num || max_num + max_blocking_ > capacity_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> rl(resize_mutex_);
+  min_num_ = min_num;
+  max_num_ = max_num;
+  if (!started_) {
+    return true;
+  }
+  while (active_num_.load() < min_num && Spawn()) {}
+  if ((max_num > min_num || max_blocking_ > 0) && monitor_ == 0) {
+    StartMonitor();
+  }
+  // 唤醒空闲线程, 多出的线程醒来后退出
   std::lock_guard<std::mutex> l(mutex_);
-  tasks_.push(std::move(task));
-  cv_.notify_one();
+  cv_.notify_all();
+  return true;
 }
 
-void ThreadPool::Impl::Loop() {
-  while (started_) {
-    std::unique_lock<std::mutex> cv_l(mutex_);
-    cv_.wait(cv_l, [&](){ return !(tasks_.empty() && started_); });
+bool ThreadPool::Impl::Spawn() {
+  for (;;) {
+    if (!started_ || active_num_.load() >= limit()) {
+      return false;
+    }
+    for (auto& worker : workers_) {
+      if (worker->Active.load()) {
+        continue;
+      }
+      if (worker->Thread.joinable()) {
+        worker->Thread.join();
+      }
+      worker->Active = true;
+      active_num_.fetch_add(1);
+      try {
+        worker->Thread = std::thread(&Impl::WorkerMain, this, worker.get());
+      } catch(const std::system_error& e) {
+        std::cout << "Caught system_error with code "
+                     "[" << e.code() << "] meaning "
+                     "[" << e.what() << "]\n";
+        worker->Active = false;
+        active_num_.fetch_sub(1);
+        return false;
+      }
+      return true;
+    }
+    // 槽位都被正在退出的线程占用, 等其结束
+    std::this_thread::yield();
+  }
+}
+
+bool ThreadPool::Impl::TryRetire(size_t limit) {
+  auto num = active_num_.load();
+  while (num > limit) {
+    if (active_num_.compare_exchange_weak(num, num - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Impl::BeginBlocking() {
+  if (blocking_depth_++ > 0 || max_blocking_ == 0) {
+    return;
+  }
+  blocking_.fetch_add(1);
+  // 没有排队任务时不补偿, 避免频繁的短阻塞反复创建线程
+  if (started_ && idle_.load() == 0 && pending_.load() > 0) {
+    std::lock_guard<std::mutex> rl(resize_mutex_);
+    Spawn();
+  }
+}
+
+void ThreadPool::Impl::EndBlocking() {
+  if (--blocking_depth_ > 0 || max_blocking_ == 0) {
+    return;
+  }
+  blocking_.fetch_sub(1);
+  // 唤醒空闲线程, 多出的线程醒来后退出, 忙碌的线程在完成当前任务后退出
+  if (active_num_.load() > limit() && idle_.load() > 0) {
+    std::lock_guard<std::mutex> l(mutex_);
+    cv_.notify_all();
+  }
+}
 
-    if (tasks_.empty() || !started_) {
+void ThreadPool::Impl::StartMonitor() {
+  monitor_ = timer_.Add(spawn_latency_, spawn_latency_, [this](){
+    CheckLatency();
+  });
+}
+
+void ThreadPool::Impl::CheckLatency() {
+  if (!started_ || idle_.load() > 0 || pending_.load() == 0 ||
+      active_num_.load() >= limit()) {
+    return;
+  }
+  auto now = util::GetSteadyTimeNs();
+  int64_t oldest;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    oldest = tasks_.OldestEnqueueTimeNs();
+  }
+  for (auto& queue : node_tasks_) {
+    std::lock_guard<std::mutex> l(queue->Mutex);
+    auto time = queue->Tasks.OldestEnqueueTimeNs();
+    if (time != 0 && (oldest == 0 || time < oldest)) {
+      oldest = time;
+    }
+  }
+  // 本地队列不便遍历, 长时间没有任务出队说明线程都被占住
+  auto latency = spawn_latency_.count();
+  if ((oldest != 0 && now - oldest >= latency) || now - last_pop_ns_.load() >= latency) {
+    std::lock_guard<std::mutex> rl(resize_mutex_);
+    Spawn();
+  }
+}
+
+void ThreadPool::Impl::CheckStall() {
+  auto now = util::GetSteadyTimeNs();
+  std::vector<RunningTask> stalls;
+  {
+    std::lock_guard<std::mutex> rl(resize_mutex_);
+    for (auto& worker : workers_) {
+      auto since = worker->RunningSince.load(std::memory_order_relaxed);
+      if (since == 0 || since == worker->Reported || now - since < stall_threshold_.count()) {
+        continue;
+      }
+      worker->Reported = since;
+      auto name = worker->RunningName.load(std::memory_order_acquire);
+      stalls.push_back({ name ? *name : DEFAULT_THREAD_NAME, worker->Index, 
+                         std::chrono::nanoseconds(now - since) });
+    }
+  }
+  // 回调在锁外执行, 其中调整线程数或查询线程池不会死锁
+  for (auto& task : stalls) {
+    if (on_stall_) {
+      on_stall_(task);
       continue;
     }
+    std::cout << "Task [" << task.Name << "] on worker [" << task.Worker << "] "
+                 "has been running for [" << task.Age.count() / 1000000 << "ms]\n";
+  }
+}
+
+void ThreadPool::Impl::PlaceWorkers() {
+  auto& topology = NumaTopology::GetInstance();
+  auto node_num = affinity_ == NO_AFFINITY ? 1 : topology.node_num();
+  if (mode_ == WORK_STEALING && node_num > 1) {
+    for (size_t i = 0; i < node_num; i++) {
+      node_tasks_.emplace_back(new NodeQueue);
+    }
+  }
+
+  auto size = workers_.size();
+  for (auto& worker : workers_) {
+    worker->Node = worker->Index % node_num;
+    auto& cpus = topology.cpus(worker->Node);
+    if (affinity_ == PIN_CPU) {
+      worker->Cpus = { cpus[(worker->Index / node_num) % cpus.size()] };
+    } else if (affinity_ == PIN_NODE && node_num > 1) {
+      worker->Cpus = cpus;
+    }
+    worker->Victims.clear();
+    for (size_t i = 1; i < size; i++) {
+      worker->Victims.push_back((worker->Index + i) % size);
+    }
+    std::stable_partition(worker->Victims.begin(), worker->Victims.end(), [&](size_t index){
+      return workers_[index]->Node == worker->Node;
+    });
+  }
+}
+
+void ThreadPool::Impl::BindCpus(Worker* worker) {
+  if (worker->Cpus.empty()) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : worker->Cpus) {
+    CPU_SET(cpu, &set);
+  }
+  auto res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (res != 0) {
+    std::cout << "Bind worker [" << worker->Index << "] failed with code "
+                 "[" << res << "]\n";
+    return;
+  }
+  // 绑定后在本线程重新分配本地队列, 内存按首次访问落在所在节点
+  std::deque<TaskBase::Ptr> tasks;
+  std::lock_guard<std::mutex> l(worker->Mutex);
+  if (worker->Tasks.empty()) {
+    worker->Tasks.swap(tasks);
+  }
+}
+
+void ThreadPool::Impl::WorkerMain(Worker* worker) {
+  BindCpus(worker);
+  current_pool_ = owner_;
+  current_ = worker;
+  auto retired = mode_ == WORK_STEALING ? StealingLoop(worker) : Loop();
+  if (retired) {
+    DrainLocal(worker);
+  }
+  current_ = nullptr;
+  current_pool_ = nullptr;
+  worker->Active = false;
+}
+
+void ThreadPool::Impl::DrainLocal(Worker* worker) {
+  std::lock_guard<std::mutex> wl(worker->Mutex);
+  std::lock_guard<std::mutex> l(mutex_);
+  while (!worker->Tasks.empty()) {
+    tasks_.Push(std::move(worker->Tasks.front()), NORMAL);
+    worker->Tasks.pop_front();
+  }
+  // 退出的线程可能刚被唤醒, 转交给其他线程
+  if (!tasks_.empty()) {
+    cv_.notify_one();
+  }
+}
+
+bool ThreadPool::Impl::Admit(TaskBase::Ptr& task) {
+  auto policy = overflow_;
+  if ((policy == BLOCK || policy == CALLER_RUNS) && TimerWheel::InTimerThread()) {
+    // 时间轮线程阻塞或代为执行都会推迟其后所有定时器(包括监控与看门狗), 越过上限入队
+    return true;
+  }
+  if (policy == BLOCK && current_ && current_->Owner == this) {
+    // 线程池线程阻塞等待自身队列腾出空位可能死锁
+    policy = CALLER_RUNS;
+  }
+  switch (policy) {
+    case BLOCK: {
+      blocked_.fetch_add(1);
+      std::unique_lock<std::mutex> l(mutex_);
+      full_waiters_.fetch_add(1);
+      full_cv_.wait(l, [&](){ return pending_.load() < queue_capacity_ || !started_; });
+      full_waiters_.fetch_sub(1);
+      if (started_) {
+        return true;
+      }
+      // 被 Stop 唤醒时线程池已不再出队, 入队后任务永远不会完成
+      l.unlock();
+      Abort(task, std::make_exception_ptr(CancelledError::Create(MODULE_NAME, 
+                                                                 "task [" + task->name() + "] discarded as pool stopped")));
+      return false;
+    }
+    case CALLER_RUNS:
+      caller_runs_.fetch_add(1);
+      RunTask(task);
+      return false;
+    case DROP_OLDEST:
+      if (DropOldest()) {
+        return true;
+      }
+      // 没有可丢弃的任务时拒绝新任务
+    default:
+      rejected_.fetch_add(1);
+      Abort(task, std::make_exception_ptr(RejectedError::Create(MODULE_NAME, 
+                                                                "task [" + task->name() + "] rejected as queue is full")));
+      return false;
+  }
+}
+
+bool ThreadPool::Impl::DropOldest() {
+  TaskBase::Ptr task;
+  PRIORITY priority;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!tasks_.PopOldest(task, priority)) {
+      for (auto& queue : node_tasks_) {
+        std::lock_guard<std::mutex> nl(queue->Mutex);
+        if (queue->Tasks.PopOldest(task, priority)) {
+          break;
+        }
+      }
+    }
+  }
+  if (!task) {
+    return false;
+  }
+  depth_[priority].fetch_sub(1);
+  pending_.fetch_sub(1);
+  dropped_.fetch_add(1);
+  NotifyFull();
+  Abort(task, std::make_exception_ptr(RejectedError::Create(MODULE_NAME, 
+                                                            "task [" + task->name() + "] dropped as queue is full")));
+  return true;
+}
+
+void ThreadPool::Impl::NotifyFull() {
+  if (full_waiters_.load() > 0) {
+    std::lock_guard<std::mutex> l(mutex_);
+    full_cv_.notify_one();
+  }
+}
+
+void ThreadPool::Impl::Abort(const TaskBase::Ptr& task, std::exception_ptr error) {
+  task->Abort(error);
+  task->Complete();
+}
 
+ThreadPool::OverflowStats ThreadPool::Impl::GetOverflowStats() const {
+  OverflowStats stats;
+  stats.Blocked = blocked_.load();
+  stats.Rejected = rejected_.load();
+  stats.CallerRuns = caller_runs_.load();
+  stats.Dropped = dropped_.load();
+  return stats;
+}
+
+void ThreadPool::Impl::PushTask(TaskBase::Ptr&& task, PRIORITY priority) {
+  task->enqueue_time_ns_ = util::GetSteadyTimeNs();
+  task->priority_ = priority;
+  if (queue_capacity_ > 0 && pending_.load() >= queue_capacity_ && !Admit(task)) {
+    return;
+  }
+  if (mode_ != WORK_STEALING) {
+    std::lock_guard<std::mutex> l(mutex_);
+    tasks_.Push(std::move(task), priority);
+    depth_[priority].fetch_add(1);
+    pending_.fetch_add(1);
+    if (idle_.load() > 0 && spinning_.load() == 0) {
+      cv_.notify_one();
+    }
+    return;
+  }
+  auto worker = current_;
+  auto local = worker && worker->Owner == this;
+  if (local && priority == NORMAL) {
+    // 本池线程提交的普通任务进入自身队列, 不经过注入队列的锁
     {
-      auto& task = tasks_.front();
-      if (!task) {
-        continue;
+      std::lock_guard<std::mutex> l(worker->Mutex);
+      worker->Tasks.push_back(std::move(task));
+    }
+    depth_[NORMAL].fetch_add(1);
+    pending_.fetch_add(1);
+  } else if (!node_tasks_.empty()) {
+    // 进入提交方所在节点的队列, 本池线程提交的进入自身节点
+    auto node = local ? worker->Node : NumaTopology::GetInstance().CurrentNode();
+    auto queue = node_tasks_[node % node_tasks_.size()].get();
+    {
+      std::lock_guard<std::mutex> l(queue->Mutex);
+      queue->Tasks.Push(std::move(task), priority);
+    }
+    depth_[priority].fetch_add(1);
+    pending_.fetch_add(1);
+  } else {
+    std::lock_guard<std::mutex> l(mutex_);
+    tasks_.Push(std::move(task), priority);
+    depth_[priority].fetch_add(1);
+    pending_.fetch_add(1);
+  }
+  if (idle_.load() > 0 && spinning_.load() == 0) {
+    std::lock_guard<std::mutex> l(mutex_);
+    cv_.notify_one();
+  }
+}
+
+void ThreadPool::Impl::PushBatch(std::vector<TaskBase::Ptr>& tasks, PRIORITY priority) {
+  if (tasks.empty()) {
+    return;
+  }
+  if (queue_capacity_ > 0) {
+    // 有上限时每个任务都可能触发溢出策略, 逐个入队
+    for (auto& task : tasks) {
+      PushTask(std::move(task), priority);
+    }
+    return;
+  }
+  auto now = util::GetSteadyTimeNs();
+  for (auto& task : tasks) {
+    task->enqueue_time_ns_ = now;
+    task->priority_ = priority;
+  }
+  auto num = tasks.size();
+  auto worker = current_;
+  auto local = worker && worker->Owner == this;
+  if (mode_ != WORK_STEALING || (!(local && priority == NORMAL) && node_tasks_.empty())) {
+    // 入队与唤醒在同一次加锁内完成
+    std::lock_guard<std::mutex> l(mutex_);
+    for (auto& task : tasks) {
+      tasks_.Push(std::move(task), priority);
+    }
+    depth_[priority].fetch_add(num);
+    pending_.fetch_add(num);
+    NotifyIdle(num);
+    return;
+  }
+  if (local && priority == NORMAL) {
+    std::lock_guard<std::mutex> l(worker->Mutex);
+    for (auto& task : tasks) {
+      worker->Tasks.push_back(std::move(task));
+    }
+  } else {
+    auto node = local ? worker->Node : NumaTopology::GetInstance().CurrentNode();
+    auto queue = node_tasks_[node % node_tasks_.size()].get();
+    std::lock_guard<std::mutex> l(queue->Mutex);
+    for (auto& task : tasks) {
+      queue->Tasks.Push(std::move(task), priority);
+    }
+  }
+  depth_[priority].fetch_add(num);
+  pending_.fetch_add(num);
+  if (idle_.load() > 0) {
+    std::lock_guard<std::mutex> l(mutex_);
+    NotifyIdle(num);
+  }
+}
+
+void ThreadPool::Impl::NotifyIdle(size_t num) {
+  auto spinning = spinning_.load();
+  auto idle = idle_.load();
+  if (num <= spinning || idle == 0) {
+    return;
+  }
+  auto wake = std::min(num - spinning, idle);
+  if (wake >= idle) {
+    cv_.notify_all();
+    return;
+  }
+  for (size_t i = 0; i < wake; i++) {
+    cv_.notify_one();
+  }
+}
+
+size_t ThreadPool::Impl::QueueDepth(PRIORITY priority) const {
+  return depth_[priority].load(std::memory_order_relaxed);
+}
+
+ThreadPool::TimerId ThreadPool::Impl::ScheduleAfter(std::chrono::nanoseconds delay, 
+                                                    std::function<void()> func) {
+  return timer_.Add(delay, std::chrono::nanoseconds(0), [this, func](){
+    PushTask(std::make_shared<TaskBase>("ScheduleAfter", func), NORMAL);
+  });
+}
+
+ThreadPool::TimerId ThreadPool::Impl::ScheduleEvery(std::chrono::nanoseconds period, 
+                                                    std::function<void()> func) {
+  auto running = std::make_shared<std::atomic<bool> >(false);
+  return timer_.Add(period, period, [this, func, running](){
+    if (running->exchange(true)) {
+      return;
+    }
+    auto task = std::make_shared<TaskBase>("ScheduleEvery", func);
+    // 被拒绝、丢弃或取消时同样触发, 否则之后的触发都会被跳过
+    task->OnDone([running](){
+      running->store(false);
+    });
+    PushTask(std::move(task), NORMAL);
+  });
+}
+
+bool ThreadPool::Impl::CancelTimer(TimerId id) {
+  return timer_.Cancel(id);
+}
+
+void ThreadPool::Impl::ParallelChunks(size_t size, size_t grain, 
+                                      const std::function<void(size_t, size_t)>& body) {
+  struct State {
+    const std::function<void(size_t, size_t)>* Body;
+    size_t Size;
+    size_t Grain;
+    size_t Ways;
+    std::atomic<size_t> Next{0};
+    std::atomic<size_t> Done{0};
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    std::exception_ptr Error;
+  };
+  auto state = std::make_shared<State>();
+  state->Body = &body;
+  state->Size = size;
+  state->Ways = std::max<size_t>(thread_num(), 1);
+  state->Grain = grain ? grain : std::max<size_t>(size / (state->Ways * 16), 1);
+
+  // 每次领取剩余量的 1/(2*线程数), 前期分块大, 末尾分块小, 兼顾开销与负载均衡
+  // 只有领到分块的线程才会访问 Body, 调用线程返回后才开始的任务领不到分块
+  auto run = [](State* state) {
+    for (;;) {
+      auto first = state->Next.load();
+      size_t last;
+      do {
+        if (first >= state->Size) {
+          return;
+        }
+        auto chunk = std::max(state->Grain, (state->Size - first) / (state->Ways * 2));
+        last = std::min(state->Size, first + chunk);
+      } while (!state->Next.compare_exchange_weak(first, last));
+
+      auto done = last - first;
+      try {
+        (*state->Body)(first, last);
+      } catch (...) {
+        std::lock_guard<std::mutex> l(state->Mutex);
+        if (!state->Error) {
+          state->Error = std::current_exception();
+        }
+        // 放弃剩余分块, 视作已完成
+        auto rest = state->Next.exchange(state->Size);
+        done += rest < state->Size ? state->Size - rest : 0;
+      }
+      if (state->Done.fetch_add(done) + done == state->Size) {
+        std::lock_guard<std::mutex> l(state->Mutex);
+        state->Cv.notify_all();
       }
-      
-      task->impl_->set_start_time(util::GetCurTimeStamp());
-      (task->impl_->func())();
-      task->impl_->set_done_time(util::GetCurTimeStamp());
-      
-      tasks_.pop();
     }
+  };
+
+  auto helpers = std::min(state->Ways - 1, size / state->Grain);
+  for (size_t i = 0; i < helpers; i++) {
+    PushTask(std::make_shared<TaskBase>("ParallelFor", [state, run](){
+      run(state.get());
+    }), NORMAL);
+  }
+  run(state.get());
+
+  std::unique_lock<std::mutex> l(state->Mutex);
+  state->Cv.wait(l, [&](){ return state->Done.load() == state->Size; });
+  if (state->Error) {
+    std::rethrow_exception(state->Error);
   }
 }
 
-ThreadPool::ThreadPool(size_t thread_num)
-    : impl_(std::make_unique<ThreadPool::Impl>(thread_num)) {}
+void ThreadPool::Impl::ParallelInvoke(const std::function<void()>& left, 
+                                      const std::function<void()>& right) {
+  enum STATUS { PENDING, RUNNING, DONE };
+  struct State {
+    std::function<void()> Func;
+    std::atomic<int> Status{PENDING};
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    std::exception_ptr Error;
+  };
+  auto state = std::make_shared<State>();
+  state->Func = right;
+  PushTask(std::make_shared<TaskBase>("ParallelInvoke", [state](){
+    int expected = PENDING;
+    if (!state->Status.compare_exchange_strong(expected, RUNNING)) {
+      return;
+    }
+    try {
+      state->Func();
+    } catch (...) {
+      state->Error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> l(state->Mutex);
+    state->Status = DONE;
+    state->Cv.notify_all();
+  }), NORMAL);
 
-ThreadPool::~ThreadPool() = default;
+  std::exception_ptr error;
+  try {
+    left();
+  } catch (...) {
+    error = std::current_exception();
+  }
 
-bool ThreadPool::Start() {
-  return impl_->Start();
+  int expected = PENDING;
+  if (state->Status.compare_exchange_strong(expected, RUNNING)) {
+    // 投递的任务还没开始, 由当前线程执行
+    try {
+      right();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  } else {
+    std::unique_lock<std::mutex> l(state->Mutex);
+    state->Cv.wait(l, [&](){ return state->Status.load() == DONE; });
+    if (!error) {
+      error = state->Error;
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
 }
 
-void ThreadPool::Stop() {
-  impl_->Stop();
+bool ThreadPool::Impl::Spin() {
+  if (idle_policy_ != SPIN_THEN_PARK) {
+    return false;
+  }
+  spinning_.fetch_add(1);
+  auto deadline = util::GetSteadyTimeNs() + spin_ns_;
+  bool found = false;
+  for (size_t i = 1; ; i++) {
+    if (pending_.load(std::memory_order_relaxed) > 0 || !started_) {
+      found = true;
+      break;
+    }
+    util::CpuRelax();
+    // 每隔一段检查一次时间并让出 CPU, 避免线程数多于核数时饿死提交方
+    if ((i & 63) == 0) {
+      if (util::GetSteadyTimeNs() > deadline) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+  spinning_.fetch_sub(1);
+  return found;
+}
+
+void ThreadPool::Impl::WakeForBacklog() {
+  if (idle_policy_ == SPIN_THEN_PARK && pending_.load() > 0 &&
+      idle_.load() > 0 && spinning_.load() == 0) {
+    std::lock_guard<std::mutex> l(mutex_);
+    cv_.notify_one();
+  }
+}
+
+bool ThreadPool::Impl::Loop() {
+  while (started_) {
+    TaskBase::Ptr task;
+    if (pending_.load() == 0) {
+      Spin();
+    }
+    {
+      std::unique_lock<std::mutex> cv_l(mutex_);
+      if (tasks_.empty() && started_) {
+        idle_.fetch_add(1);
+        auto woken = cv_.wait_for(cv_l, idle_timeout_, [&](){
+          return !tasks_.empty() || !started_ || active_num_.load() > limit();
+        });
+        idle_.fetch_sub(1);
+        if (!woken && TryRetire(min_num_.load())) {
+          return true;
+        }
+      }
+      if (active_num_.load() > limit() && TryRetire(limit())) {
+        return true;
+      }
+      if (tasks_.empty() || !started_) {
+        continue;
+      }
+      // 只在出队时持锁, 任务在锁外执行
+      PRIORITY priority;
+      tasks_.Pop(task, priority);
+      depth_[priority].fetch_sub(1);
+      pending_.fetch_sub(1);
+    }
+    WakeForBacklog();
+    RunTask(task);
+  }
+  return false;
+}
+
+bool ThreadPool::Impl::StealingLoop(Worker* worker) {
+  while (started_) {
+    if (active_num_.load() > limit() && TryRetire(limit())) {
+      return true;
+    }
+    TaskBase::Ptr task;
+    // 注入队列中有高优先级任务时优先处理, 不等本地队列清空
+    if ((depth_[HIGH].load() > 0 && PopInjection(worker, task)) ||
+        PopLocal(worker, task) || PopInjection(worker, task) || Steal(worker, task)) {
+      WakeForBacklog();
+      RunTask(task);
+      continue;
+    }
+    if (Spin()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> l(mutex_);
+    idle_.fetch_add(1);
+    auto woken = cv_.wait_for(l, idle_timeout_, [&](){
+      return pending_.load() > 0 || !started_ || active_num_.load() > limit();
+    });
+    idle_.fetch_sub(1);
+    if (!woken && TryRetire(min_num_.load())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Impl::HelpWhile(const std::function<bool()>& waiting) {
+  auto worker = current_;
+  // 每层协助都会在栈上嵌套一个任务, 过深时改为阻塞等待
+  if (!worker || help_depth_ >= MAX_HELP_DEPTH) {
+    return;
+  }
+  auto impl = worker->Owner;
+  help_depth_++;
+  TaskBase::Ptr task;
+  while (impl->started_ && waiting() && impl->TryPop(worker, task)) {
+    impl->RunTask(task);
+    task.reset();
+  }
+  help_depth_--;
+}
+
+bool ThreadPool::Impl::TryPop(Worker* worker, TaskBase::Ptr& task) {
+  if (mode_ == WORK_STEALING) {
+    // 本地队列从尾部取, 等待的子任务通常刚刚提交, 最先被取到
+    return PopLocal(worker, task) || PopInjection(worker, task) || Steal(worker, task);
+  }
+  // 取最新的任务, 等待的子任务通常刚刚提交; 按入队顺序取会广度优先展开, 嵌套层数随任务数增长
+  PRIORITY priority;
+  std::lock_guard<std::mutex> l(mutex_);
+  if (!tasks_.PopNewest(task, priority)) {
+    return false;
+  }
+  depth_[priority].fetch_sub(1);
+  pending_.fetch_sub(1);
+  return true;
+}
+
+bool ThreadPool::Impl::PopLocal(Worker* worker, TaskBase::Ptr& task) {
+  std::lock_guard<std::mutex> l(worker->Mutex);
+  if (worker->Tasks.empty()) {
+    return false;
+  }
+  task = std::move(worker->Tasks.back());
+  worker->Tasks.pop_back();
+  depth_[NORMAL].fetch_sub(1);
+  pending_.fetch_sub(1);
+  return true;
+}
+
+bool ThreadPool::Impl::PopInjection(Worker* worker, TaskBase::Ptr& task) {
+  auto node_num = node_tasks_.size();
+  // 先取本节点, 再取公共队列, 最后取其他节点
+  if (node_num > 0 && PopNode(node_tasks_[worker->Node].get(), task)) {
+    return true;
+  }
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!tasks_.empty()) {
+      PRIORITY priority;
+      tasks_.Pop(task, priority);
+      depth_[priority].fetch_sub(1);
+      pending_.fetch_sub(1);
+      return true;
+    }
+  }
+  for (size_t i = 1; i < node_num; i++) {
+    if (PopNode(node_tasks_[(worker->Node + i) % node_num].get(), task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::Impl::PopNode(NodeQueue* queue, TaskBase::Ptr& task) {
+  std::lock_guard<std::mutex> l(queue->Mutex);
+  if (queue->Tasks.empty()) {
+    return false;
+  }
+  PRIORITY priority;
+  queue->Tasks.Pop(task, priority);
+  depth_[priority].fetch_sub(1);
+  pending_.fetch_sub(1);
+  return true;
+}
+
+bool ThreadPool::Impl::Steal(Worker* thief, TaskBase::Ptr& task) {
+  for (auto index : thief->Victims) {
+    auto victim = workers_[index].get();
+    std::lock_guard<std::mutex> l(victim->Mutex);
+    if (victim->Tasks.empty()) {
+      continue;
+    }
+    task = std::move(victim->Tasks.front());
+    victim->Tasks.pop_front();
+    depth_[NORMAL].fetch_sub(1);
+    pending_.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::Impl::RunTask(const TaskBase::Ptr& task) {
+  if (!task) {
+    return;
+  }
+  auto now = util::GetSteadyTimeNs();
+  last_pop_ns_.store(now, std::memory_order_relaxed);
+  // 出队即腾出空位, 不论是否执行都要唤醒阻塞的提交方
+  NotifyFull();
+  if (task->token_.cancelled() || (task->deadline_ns_ != 0 && now > task->deadline_ns_)) {
+    // 排队期间已被取消或超时, 不再执行
+    auto reason = task->token_.cancelled() ? "] cancelled" : "] deadline exceeded";
+    Abort(task, std::make_exception_ptr(CancelledError::Create(MODULE_NAME, 
+                                                               "task [" + task->name() + reason)));
+    return;
+  }
+  task->start_time_ns_ = now;
+  task->start_time_ = util::GetCurTimeStamp();
+  // 由提交方执行时可能嵌套在另一个任务中
+  auto parent = current_task_;
+  current_task_ = task.get();
+  // 协助执行时嵌套在等待的任务中, 结束后恢复外层任务
+  auto worker = current_ && current_->Owner == this ? current_ : nullptr;
+  const std::string* parent_name = nullptr;
+  int64_t parent_since = 0;
+  if (worker) {
+    parent_name = worker->RunningName.load(std::memory_order_relaxed);
+    parent_since = worker->RunningSince.load(std::memory_order_relaxed);
+    worker->RunningName.store(task->name_, std::memory_order_release);
+    worker->RunningSince.store(now, std::memory_order_relaxed);
+  }
+  CpuFrame frame{ task.get(), cpu_frame_, record_switches_ };
+  if (record_cpu_) {
+    frame.Start = SampleCpu(record_switches_);
+    cpu_frame_ = &frame;
+  }
+  try {
+    task->Run();
+  } catch (const std::exception& e) {
+    std::cout << "Caught exception in task "
+                 "[" << task->name() << "] meaning "
+                 "[" << e.what() << "]\n";
+  } catch (...) {
+    std::cout << "Caught unknown exception in task "
+                 "[" << task->name() << "]\n";
+  }
+  current_task_ = parent;
+  if (worker) {
+    worker->RunningSince.store(parent_since, std::memory_order_relaxed);
+    worker->RunningName.store(parent_name, std::memory_order_release);
+  }
+  if (task->done_time_ns_ == 0) {
+    // 抛出异常的无结果任务没有走到 Finish
+    task->Finish();
+  }
+  if (record_cpu_) {
+    cpu_frame_ = frame.Parent;
+  }
+  if (record_latency_) {
+    RecordLatency(task);
+  }
+  task->Complete();
+}
+
+void ThreadPool::Impl::RecordLatency(const TaskBase::Ptr& task) {
+  NameStats* stats = nullptr;
+  auto worker = current_;
+  if (worker && worker->Owner == this) {
+    auto res = worker->Stats.find(task->name_);
+    if (res != worker->Stats.end()) {
+      stats = res->second;
+    }
+  }
+  if (!stats) {
+    {
+      std::lock_guard<std::mutex> l(stats_mutex_);
+      auto& slot = stats_[task->name_];
+      if (!slot) {
+        slot.reset(new NameStats);
+      }
+      stats = slot.get();
+    }
+    if (worker && worker->Owner == this) {
+      worker->Stats.emplace(task->name_, stats);
+    }
+  }
+  stats->QueueWait.Record(std::max<int64_t>(task->start_time_ns_ - task->enqueue_time_ns_, 0));
+  stats->RunTime.Record(std::max<int64_t>(task->done_time_ns_ - task->start_time_ns_, 0));
+  if (record_cpu_) {
+    stats->CpuTime.Record(task->cpu_time_ns_);
+  }
+  if (record_switches_) {
+    stats->VoluntarySwitches.fetch_add(task->voluntary_switches_, std::memory_order_relaxed);
+    stats->InvoluntarySwitches.fetch_add(task->involuntary_switches_, std::memory_order_relaxed);
+  }
+}
+
+ThreadPool::Impl::CpuUsage ThreadPool::Impl::SampleCpu(bool switches) {
+  CpuUsage usage;
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    usage.CpuTime = ts.tv_sec * 1000000000ll + ts.tv_nsec;
+  }
+  rusage ru;
+  if (switches && getrusage(RUSAGE_THREAD, &ru) == 0) {
+    usage.Voluntary = ru.ru_nvcsw;
+    usage.Involuntary = ru.ru_nivcsw;
+  }
+  return usage;
+}
+
+void ThreadPool::Impl::EndCpuSample(TaskBase* task) {
+  auto frame = cpu_frame_;
+  // 未开启统计, 或任务不是在本线程执行时被放弃
+  if (!frame || frame->Task != task || frame->Done) {
+    return;
+  }
+  frame->Done = true;
+  auto now = SampleCpu(frame->Switches);
+  CpuUsage used{ now.CpuTime - frame->Start.CpuTime, 
+                 now.Voluntary - frame->Start.Voluntary, 
+                 now.Involuntary - frame->Start.Involuntary };
+  task->cpu_time_ns_ = std::max<int64_t>(used.CpuTime - frame->Nested.CpuTime, 0);
+  task->voluntary_switches_ = std::max<int64_t>(used.Voluntary - frame->Nested.Voluntary, 0);
+  task->involuntary_switches_ = std::max<int64_t>(used.Involuntary - frame->Nested.Involuntary, 0);
+  if (frame->Parent) {
+    frame->Parent->Nested.CpuTime += used.CpuTime;
+    frame->Parent->Nested.Voluntary += used.Voluntary;
+    frame->Parent->Nested.Involuntary += used.Involuntary;
+  }
+}
+
+void ThreadPool::Impl::SnapshotStats(const std::string* name, const NameStats& source, TaskStats& stats) {
+  stats.Name = *name;
+  source.QueueWait.Snapshot(stats.QueueWait);
+  source.RunTime.Snapshot(stats.RunTime);
+  source.CpuTime.Snapshot(stats.CpuTime);
+  stats.VoluntarySwitches = source.VoluntarySwitches.load(std::memory_order_relaxed);
+  stats.InvoluntarySwitches = source.InvoluntarySwitches.load(std::memory_order_relaxed);
+}
+
+std::vector<ThreadPool::TaskStats> ThreadPool::Impl::GetTaskStats() const {
+  std::vector<TaskStats> result;
+  std::lock_guard<std::mutex> l(stats_mutex_);
+  result.reserve(stats_.size());
+  for (auto& item : stats_) {
+    result.emplace_back();
+    SnapshotStats(item.first, *item.second, result.back());
+  }
+  return result;
+}
+
+ThreadPool::Health ThreadPool::Impl::GetHealth() const {
+  Health health;
+  health.ThreadNum = thread_num();
+  health.IdleNum = idle_.load();
+  health.Pending = pending_.load();
+  auto now = util::GetSteadyTimeNs();
+  std::lock_guard<std::mutex> rl(resize_mutex_);
+  for (auto& worker : workers_) {
+    auto since = worker->RunningSince.load(std::memory_order_relaxed);
+    if (since == 0) {
+      continue;
+    }
+    auto name = worker->RunningName.load(std::memory_order_acquire);
+    RunningTask task{ name ? *name : DEFAULT_THREAD_NAME, worker->Index, 
+                      std::chrono::nanoseconds(now - since) };
+    if (stall_threshold_.count() > 0 && task.Age >= stall_threshold_) {
+      health.Stalled++;
+    }
+    health.Running.push_back(std::move(task));
+  }
+  return health;
+}
+
+bool ThreadPool::Impl::GetTaskStats(const std::string& name, TaskStats& stats) const {
+  std::lock_guard<std::mutex> l(stats_mutex_);
+  for (auto& item : stats_) {
+    if (*item.first != name) {
+      continue;
+    }
+    SnapshotStats(item.first, *item.second, stats);
+    return true;
+  }
+  return false;
+}
+
+double ThreadPool::TaskStats::CpuRatio() const {
+  return RunTime.Sum == 0 ? 0 : static_cast<double>(CpuTime.Sum) / RunTime.Sum;
+}
+
+ThreadPool::ThreadPool(size_t thread_num)
+    : ThreadPool(Option{ thread_num }) {}
+
+ThreadPool::ThreadPool(const Option& option)
+    : impl_(std::make_unique<ThreadPool::Impl>(this, option)) {}
+
+ThreadPool::~ThreadPool() = default;
+
+bool ThreadPool::Start() {
+  return impl_->Start();
+}
+
+void ThreadPool::Stop() {
+  impl_->Stop();
+}
+
+ThreadPool::TimerId ThreadPool::ScheduleAfter(std::chrono::nanoseconds delay, 
+                                              std::function<void()> func) {
+  return impl_->ScheduleAfter(delay, std::move(func));
+}
+
+ThreadPool::TimerId ThreadPool::ScheduleEvery(std::chrono::nanoseconds period, 
+                                              std::function<void()> func) {
+  return impl_->ScheduleEvery(period, std::move(func));
+}
+
+bool ThreadPool::CancelTimer(TimerId id) {
+  return impl_->CancelTimer(id);
+}
+
+size_t ThreadPool::QueueDepth(PRIORITY priority) const {
+  return impl_->QueueDepth(priority);
+}
+
+ThreadPool::OverflowStats ThreadPool::GetOverflowStats() const {
+  return impl_->GetOverflowStats();
+}
+
+std::vector<ThreadPool::TaskStats> ThreadPool::GetTaskStats() const {
+  return impl_->GetTaskStats();
+}
+
+ThreadPool::Health ThreadPool::GetHealth() const {
+  return impl_->GetHealth();
+}
+
+bool ThreadPool::GetTaskStats(const std::string& name, TaskStats& stats) const {
+  return impl_->GetTaskStats(name, stats);
+}
+
+std::shared_ptr<Task<void> > ThreadPool::WhenAll(const std::vector<TaskBase::Ptr>& tasks) {
+  auto all = MakeTaskPkg<Task<void> >("WhenAll", [](){});
+  auto remaining = std::make_shared<std::atomic<size_t> >(tasks.size());
+  if (tasks.empty()) {
+    PushTask(all);
+  }
+  for (auto& task : tasks) {
+    task->OnDone([this, all, remaining](){
+      if (remaining->fetch_sub(1) == 1) {
+        PushTask(all);
+      }
+    });
+  }
+  return all;
+}
+
+std::shared_ptr<Task<size_t> > ThreadPool::WhenAny(const std::vector<TaskBase::Ptr>& tasks) {
+  auto index = std::make_shared<std::atomic<size_t> >(tasks.size());
+  auto any = MakeTaskPkg<Task<size_t> >("WhenAny", [index](){
+    return index->load();
+  });
+  if (tasks.empty()) {
+    PushTask(any);
+  }
+  for (size_t i = 0; i < tasks.size(); i++) {
+    tasks[i]->OnDone([this, any, index, i, size = tasks.size()](){
+      auto expected = size;
+      if (index->compare_exchange_strong(expected, i)) {
+        PushTask(any);
+      }
+    });
+  }
+  return any;
+}
+
+ThreadPool* ThreadPool::Current() {
+  return Impl::current_pool();
+}
+
+TaskBase* ThreadPool::CurrentTask() {
+  return Impl::current_task();
+}
+
+size_t ThreadPool::ThreadNum() const {
+  return impl_->thread_num();
+}
+
+ThreadPool::BlockingScope::BlockingScope()
+    : pool_(Current()) {
+  if (pool_) {
+    pool_->impl_->BeginBlocking();
+  }
+}
+
+ThreadPool::BlockingScope::~BlockingScope() {
+  if (pool_) {
+    pool_->impl_->EndBlocking();
+  }
+}
+
+bool ThreadPool::Resize(size_t min_num, size_t max_num) {
+  return impl_->Resize(min_num, max_num);
+}
+
+void ThreadPool::ParallelInvoke(const std::function<void()>& left, 
+                                const std::function<void()>& right) {
+  impl_->ParallelInvoke(left, right);
+}
+
+void ThreadPool::ParallelChunks(size_t size, size_t grain, 
+                                const std::function<void(size_t, size_t)>& body) {
+  impl_->ParallelChunks(size, grain, body);
+}
+
+void ThreadPool::PushTask(TaskBase::Ptr task, PRIORITY priority) {
+  impl_->PushTask(std::move(task), priority);
+}
+
+void ThreadPool::PushBatch(std::vector<TaskBase::Ptr>& tasks, PRIORITY priority) {
+  impl_->PushBatch(tasks, priority);
+}
+
+void ThreadPool::RunInline(const TaskBase::Ptr& task) {
+  task->start_time_ns_ = util::GetSteadyTimeNs();
+  task->start_time_ = util::GetCurTimeStamp();
+  try {
+    task->Run();
+  } catch (const std::exception& e) {
+    std::cout << "Caught exception in task "
+                 "[" << task->name() << "] meaning "
+                 "[" << e.what() << "]\n";
+  } catch (...) {
+    std::cout << "Caught unknown exception in task "
+                 "[" << task->name() << "]\n";
+  }
+  if (task->done_time_ns_ == 0) {
+    task->Finish();
+  }
+  task->Complete();
+}
+
+SerialExecutor::Impl::Impl(ThreadPool* pool, std::shared_ptr<Executor::Impl> executor)
+    : pool_(pool),
+      executor_(std::move(executor)) {}
+
+void SerialExecutor::Impl::Submit(const std::string& key, ThreadPool::PRIORITY priority, 
+                                  TaskBase::Ptr task) {
+  if (executor_) {
+    // 排在同一 key 之后等待的任务也计入执行器的积压
+    executor_->Admit(task);
+  }
+  // 拒绝、取消等未执行的情况同样会触发完成回调, 不会卡住后续任务
+  task->OnDone([self = shared_from_this(), key](){
+    self->Next(key);
+  });
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto& queue = queues_[key];
+    queue.push_back({ task, priority });
+    if (queue.size() > 1) {
+      return;
+    }
+  }
+  Dispatch(std::move(task), priority);
+}
+
+void SerialExecutor::Impl::Next(const std::string& key) {
+  Entry next;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto res = queues_.find(key);
+    res->second.pop_front();
+    if (res->second.empty()) {
+      queues_.erase(res);
+      if (queues_.empty()) {
+        idle_cv_.notify_all();
+      }
+      return;
+    }
+    next = res->second.front();
+  }
+  Dispatch(std::move(next.Task), next.Priority);
+}
+
+void SerialExecutor::Impl::Dispatch(TaskBase::Ptr task, ThreadPool::PRIORITY priority) {
+  if (executor_) {
+    executor_->Dispatch(priority, std::move(task));
+  } else {
+    pool_->PushTask(std::move(task), priority);
+  }
+}
+
+size_t SerialExecutor::Impl::key_num() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return queues_.size();
+}
+
+void SerialExecutor::Impl::Wait() {
+  std::unique_lock<std::mutex> l(mutex_);
+  idle_cv_.wait(l, [this](){ return queues_.empty(); });
+}
+
+SerialExecutor::SerialExecutor(ThreadPool& pool)
+    : pool_(&pool),
+      impl_(std::make_shared<Impl>(&pool)) {}
+
+SerialExecutor::SerialExecutor(Executor& executor)
+    : pool_(executor.pool_),
+      impl_(std::make_shared<Impl>(executor.pool_, executor.impl_)) {}
+
+SerialExecutor::~SerialExecutor() = default;
+
+void SerialExecutor::Submit(const std::string& key, ThreadPool::PRIORITY priority, TaskBase::Ptr task) {
+  impl_->Submit(key, priority, std::move(task));
+}
+
+size_t SerialExecutor::KeyNum() const {
+  return impl_->key_num();
+}
+
+void SerialExecutor::Wait() {
+  impl_->Wait();
+}
+
+TaskGraph::Impl::Impl(ThreadPool* pool)
+    : pool_(pool) {}
+
+TaskGraph::NodeId TaskGraph::Impl::AddNode(std::string name, std::function<void()> func, 
+                                           ThreadPool::PRIORITY priority) {
+  std::lock_guard<std::mutex> l(mutex_);
+  nodes_.push_back({ std::move(name), std::move(func), priority, {}, {} });
+  return nodes_.size() - 1;
+}
+
+bool TaskGraph::Impl::AddEdge(NodeId from, NodeId to) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (from >= nodes_.size() || to >= nodes_.size() || from == to || Reachable(to, from)) {
+    return false;
+  }
+  auto& successors = nodes_[from].Successors;
+  if (std::find(successors.begin(), successors.end(), to) != successors.end()) {
+    return true;
+  }
+  successors.push_back(to);
+  nodes_[to].Predecessors.push_back(from);
+  return true;
+}
+
+size_t TaskGraph::Impl::node_num() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return nodes_.size();
+}
+
+bool TaskGraph::Impl::Reachable(NodeId from, NodeId to) const {
+  std::vector<NodeId> stack{ from };
+  std::vector<bool> visited(nodes_.size(), false);
+  while (!stack.empty()) {
+    auto id = stack.back();
+    stack.pop_back();
+    if (id == to) {
+      return true;
+    }
+    if (visited[id]) {
+      continue;
+    }
+    visited[id] = true;
+    stack.insert(stack.end(), nodes_[id].Successors.begin(), nodes_[id].Successors.end());
+  }
+  return false;
+}
+
+std::shared_ptr<Task<void> > TaskGraph::Impl::Run() {
+  auto run = std::make_shared<RunState>();
+  std::vector<NodeId> roots;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto num = nodes_.size();
+    run->Remaining.reset(new std::atomic<size_t>[num]);
+    for (size_t i = 0; i < num; i++) {
+      run->Remaining[i] = nodes_[i].Predecessors.size();
+      if (nodes_[i].Predecessors.empty()) {
+        roots.push_back(i);
+      }
+    }
+    run->Starts.assign(num, 0);
+    run->Dones.assign(num, 0);
+    run->Unfinished = num;
+  }
+  // 结果任务与运行状态互相引用, 运行结束时由 Finish 解开
+  run->Result = pool_->MakeTaskPkg<Task<void> >("TaskGraph", [run](){
+    if (run->Error) {
+      std::rethrow_exception(run->Error);
+    }
+  });
+  auto result = run->Result;
+  run->Start = util::GetSteadyTimeNs();
+  if (roots.empty()) {
+    Finish(run);
+  }
+  for (auto id : roots) {
+    Dispatch(run, id);
+  }
+  return result;
+}
+
+void TaskGraph::Impl::Dispatch(const std::shared_ptr<RunState>& run, NodeId id) {
+  auto& node = nodes_[id];
+  auto task = pool_->MakeTaskPkg<TaskBase>(node.Name, [this, state = run.get(), id](){
+    Execute(state, id);
+  });
+  // 被拒绝或取消的节点同样会触发完成回调, 不会卡住整张图
+  task->OnDone([self = shared_from_this(), run, id](){
+    self->Complete(run, id);
+  });
+  pool_->PushTask(std::move(task), node.Priority);
+}
+
+void TaskGraph::Impl::Execute(RunState* run, NodeId id) {
+  if (run->Failed.load()) {
+    return;
+  }
+  run->Starts[id] = util::GetSteadyTimeNs();
+  try {
+    nodes_[id].Func();
+  } catch (...) {
+    Fail(run, std::current_exception());
+  }
+  run->Dones[id] = util::GetSteadyTimeNs();
+}
+
+void TaskGraph::Impl::Complete(const std::shared_ptr<RunState>& run, NodeId id) {
+  auto& node = nodes_[id];
+  if (run->Starts[id] == 0 && !run->Failed.load()) {
+    Fail(run.get(), std::make_exception_ptr(RejectedError::Create(MODULE_NAME, 
+        "task graph node [" + node.Name + "] was not executed by the pool")));
+  }
+  for (auto next : node.Successors) {
+    if (run->Remaining[next].fetch_sub(1) == 1) {
+      Dispatch(run, next);
+    }
+  }
+  if (run->Unfinished.fetch_sub(1) == 1) {
+    Finish(run);
+  }
+}
+
+void TaskGraph::Impl::Fail(RunState* run, std::exception_ptr error) {
+  std::lock_guard<std::mutex> l(run->Mutex);
+  if (!run->Error) {
+    run->Error = error;
+  }
+  run->Failed = true;
+}
+
+void TaskGraph::Impl::Finish(const std::shared_ptr<RunState>& run) {
+  run->Done = util::GetSteadyTimeNs();
+  auto result = std::move(run->Result);
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    last_ = run;
+  }
+  pool_->PushTask(std::move(result), ThreadPool::NORMAL);
+}
+
+bool TaskGraph::Impl::GetReport(Report& report) const {
+  std::shared_ptr<RunState> run;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    run = last_;
+  }
+  if (!run) {
+    return false;
+  }
+  auto num = run->Starts.size();
+  report = Report();
+  report.Total = run->Done - run->Start;
+  for (size_t i = 0; i < num; i++) {
+    NodeReport node;
+    node.Name = nodes_[i].Name;
+    node.Skipped = run->Starts[i] == 0;
+    if (!node.Skipped) {
+      node.Start = run->Starts[i] - run->Start;
+      node.Done = run->Dones[i] - run->Start;
+    }
+    report.Nodes.push_back(std::move(node));
+  }
+
+  // 从最后完成的节点回溯, 每一步取最晚完成的已执行前驱
+  auto later = [&](NodeId a, NodeId b) {
+    return run->Dones[a] < run->Dones[b];
+  };
+  std::vector<NodeId> executed;
+  for (size_t i = 0; i < num; i++) {
+    if (run->Starts[i] != 0) {
+      executed.push_back(i);
+    }
+  }
+  if (executed.empty()) {
+    return true;
+  }
+  auto id = *std::max_element(executed.begin(), executed.end(), later);
+  for (;;) {
+    report.CriticalPath.push_back(id);
+    report.CriticalRunTime += run->Dones[id] - run->Starts[id];
+    std::vector<NodeId> preds;
+    for (auto pred : nodes_[id].Predecessors) {
+      if (run->Starts[pred] != 0) {
+        preds.push_back(pred);
+      }
+    }
+    if (preds.empty()) {
+      break;
+    }
+    id = *std::max_element(preds.begin(), preds.end(), later);
+  }
+  std::reverse(report.CriticalPath.begin(), report.CriticalPath.end());
+  return true;
+}
+
+std::string TaskGraph::Report::ToString() const {
+  std::ostringstream oss;
+  oss << "total: " << Total / 1000 << "us critical run time: " << CriticalRunTime / 1000 << "us\n";
+  oss << "critical path:";
+  for (size_t i = 0; i < CriticalPath.size(); i++) {
+    oss << (i ? " -> " : " ") << Nodes[CriticalPath[i]].Name;
+  }
+  oss << "\n";
+  for (size_t i = 0; i < Nodes.size(); i++) {
+    auto& node = Nodes[i];
+    auto critical = std::find(CriticalPath.begin(), CriticalPath.end(), i) != CriticalPath.end();
+    oss << (critical ? " * " : "   ") << "[" << i << "] " << node.Name;
+    if (node.Skipped) {
+      oss << " skipped\n";
+    } else {
+      oss << " start: " << node.Start / 1000 << "us run: " << (node.Done - node.Start) / 1000 << "us\n";
+    }
+  }
+  return oss.str();
+}
+
+TaskGraph::TaskGraph(ThreadPool& pool)
+    : impl_(std::make_shared<Impl>(&pool)) {}
+
+TaskGraph::~TaskGraph() = default;
+
+TaskGraph::NodeId TaskGraph::AddNode(std::string name, std::function<void()> func, 
+                                     ThreadPool::PRIORITY priority) {
+  return impl_->AddNode(std::move(name), std::move(func), priority);
+}
+
+bool TaskGraph::AddEdge(NodeId from, NodeId to) {
+  return impl_->AddEdge(from, to);
+}
+
+size_t TaskGraph::NodeNum() const {
+  return impl_->node_num();
+}
+
+std::shared_ptr<Task<void> > TaskGraph::Run() {
+  return impl_->Run();
+}
+
+bool TaskGraph::GetReport(Report& report) const {
+  return impl_->GetReport(report);
+}
+
+PipelineBase::Impl::Impl(PipelineBase* owner, ThreadPool* pool, size_t capacity)
+    : owner_(owner),
+      pool_(pool),
+      create_time_ns_(util::GetSteadyTimeNs()) {
+  for (size_t i = capacity; i > 0; i--) {
+    free_.push_back(i - 1);
+  }
+}
+
+void PipelineBase::Impl::AddStage(std::string name, MODE mode, size_t parallelism, 
+                                  std::function<bool(size_t)> func) {
+  std::unique_ptr<Stage> stage(new Stage);
+  stage->Name = std::move(name);
+  stage->Mode = mode;
+  stage->Parallelism = mode == PARALLEL ? parallelism : 1;
+  stage->Func = std::move(func);
+  std::lock_guard<std::mutex> l(mutex_);
+  stages_.push_back(std::move(stage));
+}
+
+bool PipelineBase::Impl::Acquire(size_t& slot, bool wait) {
+  std::unique_lock<std::mutex> l(mutex_);
+  if (free_.empty()) {
+    if (!wait) {
+      return false;
+    }
+    cv_.wait(l, [&](){ return !free_.empty(); });
+  }
+  slot = free_.back();
+  free_.pop_back();
+  live_++;
+  return true;
+}
+
+void PipelineBase::Impl::Submit(size_t slot) {
+  Token token;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    token = { slot, next_seq_++, false };
+  }
+  Post(token, 0, false);
+}
+
+void PipelineBase::Impl::Wait() {
+  std::unique_lock<std::mutex> l(mutex_);
+  cv_.wait(l, [&](){ return live_ == 0; });
+}
+
+size_t PipelineBase::Impl::size() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return live_;
+}
+
+void PipelineBase::Impl::Post(Token token, size_t index, bool admitted) {
+  auto task = pool_->MakeTaskPkg<TaskBase>(stages_.empty() ? std::string("Pipeline") : stages_[index]->Name, 
+                                           [self = shared_from_this(), token, index, admitted](){
+    self->Drive(token, index, admitted);
+  });
+  // 被拒绝、丢弃或取消时同样触发, 否则槽位与阶段的占用永远不会释放
+  task->OnDone([self = shared_from_this(), raw = task.get(), token, index, admitted](){
+    if (raw->start_time_ns() == 0) {
+      self->Abandon(token, index, admitted);
+    }
+  });
+  pool_->PushTask(std::move(task));
+}
+
+void PipelineBase::Impl::Abandon(Token token, size_t index, bool admitted) {
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!token.Dropped && index < stages_.size()) {
+      stages_[index]->Dropped++;
+    }
+  }
+  // 按丢弃处理, 在当前线程上走完剩余阶段: 释放已占用的阶段, 并在 IN_ORDER 阶段占位
+  token.Dropped = true;
+  Drive(token, index, admitted);
+}
+
+bool PipelineBase::Impl::Admit(Stage& stage, const Token& token) {
+  bool runnable;
+  if (stage.Mode == IN_ORDER) {
+    runnable = stage.Running == 0 && token.Seq == stage.NextSeq;
+  } else {
+    // 有数据在排队时新到的数据排在后面, 避免缓冲中的数据被饿死
+    runnable = stage.Buffer.empty() && 
+               (stage.Parallelism == 0 || stage.Running < stage.Parallelism);
+  }
+  if (runnable) {
+    stage.Running++;
+    return true;
+  }
+  if (stage.Mode == IN_ORDER) {
+    stage.Ordered.emplace(token.Seq, token);
+  } else {
+    stage.Buffer.push_back(token);
+  }
+  stage.MaxBuffered = std::max(stage.MaxBuffered, stage.Buffer.size() + stage.Ordered.size());
+  return false;
+}
+
+bool PipelineBase::Impl::PopRunnable(Stage& stage, Token& token) {
+  if (stage.Mode == IN_ORDER) {
+    if (stage.Running > 0 || stage.Ordered.empty() || stage.Ordered.begin()->first != stage.NextSeq) {
+      return false;
+    }
+    token = stage.Ordered.begin()->second;
+    stage.Ordered.erase(stage.Ordered.begin());
+  } else {
+    if (stage.Buffer.empty() || (stage.Parallelism > 0 && stage.Running >= stage.Parallelism)) {
+      return false;
+    }
+    token = stage.Buffer.front();
+    stage.Buffer.pop_front();
+  }
+  stage.Running++;
+  return true;
+}
+
+void PipelineBase::Impl::Drive(Token token, size_t index, bool admitted) {
+  std::unique_lock<std::mutex> l(mutex_);
+  for (; index < stages_.size(); index++, admitted = false) {
+    auto& stage = *stages_[index];
+    if (!admitted) {
+      // 已丢弃的数据只需在 IN_ORDER 阶段占位
+      if (token.Dropped && stage.Mode != IN_ORDER) {
+        continue;
+      }
+      if (!Admit(stage, token)) {
+        return;
+      }
+    }
+    l.unlock();
+    bool keep = true;
+    bool error = false;
+    int64_t cost = 0;
+    if (!token.Dropped) {
+      auto begin = util::GetSteadyTimeNs();
+      try {
+        keep = stage.Func(token.Slot);
+      } catch (const std::exception& e) {
+        error = true;
+        std::cout << "Caught exception in pipeline stage "
+                     "[" << stage.Name << "] meaning "
+                     "[" << e.what() << "]\n";
+      } catch (...) {
+        error = true;
+      }
+      cost = util::GetSteadyTimeNs() - begin;
+    }
+    l.lock();
+    stage.Running--;
+    if (!token.Dropped) {
+      stage.Processed++;
+      stage.BusyTime += cost;
+      stage.Errors += error ? 1 : 0;
+      stage.Dropped += keep && !error ? 0 : 1;
+      token.Dropped = !keep || error;
+    }
+    if (stage.Mode == IN_ORDER) {
+      stage.NextSeq++;
+    }
+    // 本线程带着数据进入下一阶段, 空出的位置交给缓冲中的数据
+    Token next;
+    if (PopRunnable(stage, next)) {
+      l.unlock();
+      Post(next, index, true);
+      l.lock();
+    }
+  }
+  l.unlock();
+  owner_->Release(token.Slot);
+  l.lock();
+  free_.push_back(token.Slot);
+  live_--;
+  cv_.notify_all();
+}
+
+std::vector<PipelineBase::StageStats> PipelineBase::Impl::GetStats() const {
+  std::vector<StageStats> stats;
+  auto elapsed = std::max<int64_t>(util::GetSteadyTimeNs() - create_time_ns_, 1);
+  std::lock_guard<std::mutex> l(mutex_);
+  for (auto& stage : stages_) {
+    StageStats s;
+    s.Name = stage->Name;
+    s.Processed = stage->Processed;
+    s.Dropped = stage->Dropped;
+    s.Errors = stage->Errors;
+    s.Running = stage->Running;
+    s.Buffered = stage->Buffer.size() + stage->Ordered.size();
+    s.MaxBuffered = stage->MaxBuffered;
+    s.BusyTime = stage->BusyTime;
+    s.Throughput = stage->Processed * 1e9 / elapsed;
+    s.Occupancy = static_cast<double>(stage->BusyTime) / elapsed;
+    stats.push_back(std::move(s));
+  }
+  return stats;
+}
+
+PipelineBase::PipelineBase(ThreadPool& pool, size_t capacity)
+    : impl_(std::make_shared<Impl>(this, &pool, std::max<size_t>(capacity, 1))) {}
+
+PipelineBase::~PipelineBase() = default;
+
+void PipelineBase::Wait() {
+  impl_->Wait();
+}
+
+size_t PipelineBase::Size() const {
+  return impl_->size();
+}
+
+std::vector<PipelineBase::StageStats> PipelineBase::GetStats() const {
+  return impl_->GetStats();
+}
+
+void PipelineBase::AddStageImpl(std::string name, MODE mode, size_t parallelism, 
+                                std::function<bool(size_t)> func) {
+  impl_->AddStage(std::move(name), mode, parallelism, std::move(func));
+}
+
+bool PipelineBase::Acquire(size_t& slot, bool wait) {
+  return impl_->Acquire(slot, wait);
 }
 
-void ThreadPool::PushTask(TaskBase::Ptr task) {
-  impl_->PushTask(std::move(task));
+void PipelineBase::Submit(size_t slot) {
+  impl_->Submit(slot);
 }
 
 } // namespace seeker
\ No newline at end of file
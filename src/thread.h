@@ -10,68 +10,597 @@
 #define __SEEKER_SRC_THREAD_H__
 
 #include <queue>
+#include <deque>
+#include <map>
 #include <vector>
 #include <mutex>
 #include <atomic>
 #include <thread>
 #include <future>
+#include <unordered_map>
 #include <condition_variable>
 
 #include <pthread.h>
 #include <semaphore.h>
 #include "../include/exception.h"
 #include "../include/thread.hpp"
+#include "thread/timer_wheel.h"
+#include "thread/task_queue.h"
+#include "thread/numa.h"
+#include "thread/histogram.h"
 
 namespace seeker {
-class TaskBase::Impl {
+class ThreadPool::Impl {
+  /**
+   * @brief 同名任务的耗时直方图
+   */
+  struct NameStats {
+    Histogram QueueWait;
+    Histogram RunTime;
+    Histogram CpuTime;
+    std::atomic<uint64_t> VoluntarySwitches{0};
+    std::atomic<uint64_t> InvoluntarySwitches{0};
+  };
+
+  /**
+   * @brief 线程 CPU 时间与上下文切换次数的采样
+   */
+  struct CpuUsage {
+    int64_t CpuTime = 0;
+    int64_t Voluntary = 0;
+    int64_t Involuntary = 0;
+  };
+
+  /**
+   * @brief 执行中任务的 CPU 采样帧, 嵌套执行的任务结算后累加到外层的 Nested 中以便扣除
+   */
+  struct CpuFrame {
+    TaskBase* Task;
+    CpuFrame* Parent;
+    bool Switches;
+    bool Done = false;
+    CpuUsage Start;
+    CpuUsage Nested;
+  };
+
+  /**
+   * @brief 工作线程槽位, 弹性伸缩时线程退出后槽位保留, 供新线程复用
+   */
+  struct Worker {
+    Impl* Owner;
+    size_t Index;
+    std::thread Thread;
+    /**
+     * @brief 槽位上的线程仍在运行
+     */
+    std::atomic<bool> Active{false};
+    /**
+     * @brief 所在 NUMA 节点
+     */
+    size_t Node = 0;
+    /**
+     * @brief 绑定的 CPU, 为空时不绑定
+     */
+    std::vector<int> Cpus;
+    /**
+     * @brief 窃取顺序, 同节点的线程在前
+     */
+    std::vector<size_t> Victims;
+    /**
+     * @brief 任务名到统计的缓存, 只由槽位上的线程访问, 命中时无需加锁
+     */
+    std::unordered_map<const std::string*, NameStats*> Stats;
+    /**
+     * @brief 正在执行的任务名与开始时间, 由槽位上的线程写入供看门狗扫描, 任务名以 release 发布, 开始时间为 0 表示空闲
+     * 两者分别读取, 扫描时可能看到刚切换任务时的不一致组合
+     */
+    std::atomic<const std::string*> RunningName{nullptr};
+    std::atomic<int64_t> RunningSince{0};
+    /**
+     * @brief 已报告过的任务的开始时间, 只由看门狗访问
+     */
+    int64_t Reported = 0;
+    std::mutex Mutex;
+    /**
+     * @brief 本地队列, 自身从尾部取, 窃取者从头部取
+     */
+    std::deque<TaskBase::Ptr> Tasks;
+  };
+
+  /**
+   * @brief NUMA 节点的注入队列
+   */
+  struct NodeQueue {
+    std::mutex Mutex;
+    TaskQueue Tasks;
+  };
+
  public:
-  Impl(std::string name, Func func);
+  Impl(ThreadPool* owner, const Option& option);
   ~Impl();
 
-  inline std::string name() const {
-    return name_;
+  bool Start();
+  void Stop();
+  void PushTask(TaskBase::Ptr&& task, PRIORITY priority);
+  void PushBatch(std::vector<TaskBase::Ptr>& tasks, PRIORITY priority);
+  size_t QueueDepth(PRIORITY priority) const;
+  OverflowStats GetOverflowStats() const;
+  std::vector<TaskStats> GetTaskStats() const;
+  bool GetTaskStats(const std::string& name, TaskStats& stats) const;
+  Health GetHealth() const;
+  /**
+   * @brief 当前线程所属的线程池, 非线程池线程返回 nullptr
+   */
+  static inline ThreadPool* current_pool() {
+    return current_pool_;
   }
-  inline time_t start_time() const {
-    return start_time_;
+  static inline TaskBase* current_task() {
+    return current_task_;
   }
-  inline void set_start_time(time_t time) {
-    start_time_ = time;
+  /**
+   * @brief 线程池线程阻塞等待前执行本池其他排队任务, 直到 waiting 返回 false 或无任务可取
+   * 非线程池线程直接返回; 等待方持有的锁若被协助执行的任务获取会死锁, 持锁时不应等待
+   */
+  static void HelpWhile(const std::function<bool()>& waiting);
+  /**
+   * @brief 任务完成时结算本线程上为其开启的 CPU 采样, 在结果就绪前调用以便等待方读取
+   */
+  static void EndCpuSample(TaskBase* task);
+  /**
+   * @brief 池内的时间轮, 回调在时间轮线程上执行, 不应阻塞
+   */
+  inline TimerWheel& timer() {
+    return timer_;
   }
-  inline time_t done_time() const {
-    return done_time_;
+  /**
+   * @brief 运行中的线程数, 未启动时为配置的最少线程数
+   */
+  inline size_t thread_num() const {
+    return started_ ? active_num_.load() : min_num_.load();
   }
-  inline void set_done_time(time_t time) {
-    done_time_ = time;
+  bool Resize(size_t min_num, size_t max_num);
+  /**
+   * @brief 当前线程进入阻塞调用, 有排队任务且没有空闲线程时立即补偿一个线程
+   */
+  void BeginBlocking();
+  void EndBlocking();
+
+  void ParallelChunks(size_t size, size_t grain, const std::function<void(size_t, size_t)>& body);
+  void ParallelInvoke(const std::function<void()>& left, const std::function<void()>& right);
+
+  TimerId ScheduleAfter(std::chrono::nanoseconds delay, std::function<void()> func);
+  TimerId ScheduleEvery(std::chrono::nanoseconds period, std::function<void()> func);
+  bool CancelTimer(TimerId id);
+  
+ private:
+  /**
+   * @brief 在空闲槽位上启动线程, 需持有 resize_mutex_
+   */
+  bool Spawn();
+  /**
+   * @brief 运行中的线程数多于 limit 时占用一个退出名额
+   */
+  bool TryRetire(size_t limit);
+  /**
+   * @brief 线程数上限, 为最多线程数加上阻塞中的线程数, 后者不超过补偿上限
+   */
+  inline size_t limit() const {
+    return max_num_.load() + std::min(blocking_.load(), max_blocking_);
   }
-  inline const Func& func() const {
-    return func_;
+  /**
+   * @brief 由时间轮周期调用, 任务排队过久且没有空闲线程时扩容
+   */
+  void CheckLatency();
+  void StartMonitor();
+  /**
+   * @brief 由时间轮周期调用, 报告执行超过阈值的任务
+   */
+  void CheckStall();
+  /**
+   * @brief 按绑核策略为各槽位分配节点、CPU 与窃取顺序
+   */
+  void PlaceWorkers();
+  void BindCpus(Worker* worker);
+  void WorkerMain(Worker* worker);
+  /**
+   * @brief 退出的线程把本地队列中剩余的任务移到注入队列
+   */
+  void DrainLocal(Worker* worker);
+  /**
+   * @brief 队列已满时按策略处理新任务
+   * @return true 继续入队; false 任务已被执行或拒绝
+   */
+  bool Admit(TaskBase::Ptr& task);
+  /**
+   * @brief 丢弃一个排队中的任务, 工作窃取模式下只从注入队列中丢弃
+   */
+  bool DropOldest();
+  /**
+   * @brief 出队后唤醒一个因队列已满而阻塞的提交方
+   */
+  void NotifyFull();
+  /**
+   * @brief 以 error 完成未执行的任务
+   */
+  void Abort(const TaskBase::Ptr& task, std::exception_ptr error);
+  /**
+   * @brief SPIN_THEN_PARK 下休眠前自旋等待新任务
+   * @return true 期间有任务到达
+   */
+  bool Spin();
+  /**
+   * @brief 取到任务后仍有积压且没有自旋线程时唤醒一个休眠线程, 弥补自旋期间省去的唤醒
+   */
+  void WakeForBacklog();
+  /**
+   * @brief 新增 num 个任务后唤醒休眠线程, 自旋中的线程会自行取走任务, 需持有 mutex_
+   */
+  void NotifyIdle(size_t num);
+  bool Loop();
+  bool StealingLoop(Worker* worker);
+
+  /**
+   * @brief 不阻塞地从本池任意队列取一个任务
+   */
+  bool TryPop(Worker* worker, TaskBase::Ptr& task);
+  bool PopLocal(Worker* worker, TaskBase::Ptr& task);
+  bool PopInjection(Worker* worker, TaskBase::Ptr& task);
+  bool PopNode(NodeQueue* queue, TaskBase::Ptr& task);
+  bool Steal(Worker* thief, TaskBase::Ptr& task);
+  void RunTask(const TaskBase::Ptr& task);
+  void RecordLatency(const TaskBase::Ptr& task);
+  static CpuUsage SampleCpu(bool switches);
+  static void SnapshotStats(const std::string* name, const NameStats& source, TaskStats& stats);
+
+ private:
+  ThreadPool* owner_;
+  std::atomic<bool> started_;
+  MODE mode_;
+  /**
+   * @brief 线程槽位数, 即构造时的最多线程数加上补偿线程数
+   */
+  size_t capacity_;
+  std::atomic<size_t> min_num_;
+  std::atomic<size_t> max_num_;
+  /**
+   * @brief 运行中且未决定退出的线程数
+   */
+  std::atomic<size_t> active_num_{0};
+  size_t max_blocking_;
+  /**
+   * @brief 处于阻塞调用中的线程数
+   */
+  std::atomic<size_t> blocking_{0};
+  std::chrono::nanoseconds spawn_latency_;
+  std::chrono::nanoseconds idle_timeout_;
+  /**
+   * @brief 保护线程的启动、回收与线程数范围的调整
+   */
+  mutable std::mutex resize_mutex_;
+  TimerId monitor_ = 0;
+  std::chrono::nanoseconds stall_threshold_;
+  std::function<void(const RunningTask&)> on_stall_;
+  /**
+   * @brief 最近一次取出任务的时间, 用于判断线程是否都被阻塞
+   */
+  std::atomic<int64_t> last_pop_ns_{0};
+  AFFINITY affinity_;
+  size_t queue_capacity_;
+  OVERFLOW_POLICY overflow_;
+  /**
+   * @brief 队列满时阻塞的提交方在此等待
+   */
+  std::condition_variable full_cv_;
+  std::atomic<size_t> full_waiters_{0};
+  std::atomic<uint64_t> blocked_{0};
+  std::atomic<uint64_t> rejected_{0};
+  std::atomic<uint64_t> caller_runs_{0};
+  std::atomic<uint64_t> dropped_{0};
+  bool record_latency_;
+  bool record_cpu_;
+  bool record_switches_;
+  mutable std::mutex stats_mutex_;
+  std::unordered_map<const std::string*, std::unique_ptr<NameStats> > stats_;
+  /**
+   * @brief 各 NUMA 节点的注入队列, 仅在工作窃取模式下绑核且存在多个节点时启用
+   */
+  std::vector<std::unique_ptr<NodeQueue> > node_tasks_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  /**
+   * @brief 共享队列, 工作窃取模式下作为注入队列
+   */
+  TaskQueue tasks_;
+  std::vector<std::unique_ptr<Worker> > workers_;
+  /**
+   * @brief 所有队列中待执行的任务数
+   */
+  std::atomic<size_t> pending_{0};
+  /**
+   * @brief 各优先级排队中的任务数, 本地队列中的任务计入 NORMAL
+   */
+  std::atomic<size_t> depth_[PRIORITY_NUM] = {};
+  /**
+   * @brief 正在等待的线程数, 无空闲线程时提交方无需唤醒
+   */
+  std::atomic<size_t> idle_{0};
+  /**
+   * @brief 正在自旋的线程数, 大于 0 时提交方无需唤醒
+   */
+  std::atomic<size_t> spinning_{0};
+  IDLE_POLICY idle_policy_;
+  int64_t spin_ns_;
+  /**
+   * @brief 定时任务共用的时间轮
+   */
+  TimerWheel timer_;
+
+  static thread_local Worker* current_;
+  static thread_local ThreadPool* current_pool_;
+  static thread_local TaskBase* current_task_;
+  /**
+   * @brief 协助执行的嵌套层数
+   */
+  static thread_local size_t help_depth_;
+  static thread_local size_t blocking_depth_;
+  static thread_local CpuFrame* cpu_frame_;
+};
+
+class Executor::Impl : public std::enable_shared_from_this<Executor::Impl> {
+  /**
+   * @brief 周期定时器的状态, 取消时等待已投递的那次执行结束
+   */
+  struct Timer {
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    bool Cancelled = false;
+    bool Running = false;
+  };
+
+ public:
+  Impl(ThreadPool* pool, std::string name, size_t quota, size_t capacity);
+
+  /**
+   * @brief 计入积压后按配额投递
+   */
+  void Submit(ThreadPool::PRIORITY priority, TaskBase::Ptr task);
+  /**
+   * @brief 计入积压, 积压已满时阻塞至有任务完成; 线程池线程与时间轮线程上不阻塞, 越过上限计入
+   */
+  void Admit(const TaskBase::Ptr& task);
+  /**
+   * @brief 已计入积压的任务, 配额未满时投递到线程池, 否则在执行器内排队
+   */
+  void Dispatch(ThreadPool::PRIORITY priority, TaskBase::Ptr task);
+  ThreadPool::TimerId ScheduleEvery(std::chrono::nanoseconds period, std::function<void()> func);
+  bool CancelTimer(ThreadPool::TimerId id);
+
+  inline const std::string& name() const {
+    return name_;
+  }
+  inline size_t quota() const {
+    return quota_;
   }
+  inline size_t capacity() const {
+    return capacity_;
+  }
+  size_t running() const;
+  size_t pending() const;
+
  private:
+  /**
+   * @brief 一个任务完成, 归还配额或投递下一个排队任务
+   */
+  void Next();
+
+ private:
+  ThreadPool* pool_;
   std::string name_;
-  time_t start_time_ = 0;
-  time_t done_time_ = 0;
-  Func func_;
+  size_t quota_;
+  size_t capacity_;
+  mutable std::mutex mutex_;
+  size_t running_ = 0;
+  TaskQueue tasks_;
+  /**
+   * @brief 已提交、尚未完成的任务数, 含串行执行器中等待前一个任务的
+   */
+  size_t backlog_ = 0;
+  size_t full_waiters_ = 0;
+  std::condition_variable full_cv_;
+  std::unordered_map<ThreadPool::TimerId, std::shared_ptr<Timer> > timers_;
 };
 
-class ThreadPool::Impl {
+class ExecutorRegistry::Impl {
  public:
-  Impl(size_t thread_num);
-  ~Impl();
+  Impl();
+
+  Executor::Ptr Get(const std::string& name, size_t quota, size_t capacity);
+  std::vector<Executor::Ptr> List() const;
+  inline ThreadPool& pool() {
+    return pool_;
+  }
 
-  bool Start();
-  void Stop();
-  void PushTask(TaskBase::Ptr&& task);
-  
  private:
-  void Loop();
+  ThreadPool pool_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Executor::Ptr> executors_;
+};
+
+class SerialExecutor::Impl : public std::enable_shared_from_this<SerialExecutor::Impl> {
+  struct Entry {
+    TaskBase::Ptr Task;
+    ThreadPool::PRIORITY Priority;
+  };
+
+ public:
+  Impl(ThreadPool* pool, std::shared_ptr<Executor::Impl> executor = nullptr);
+
+  void Submit(const std::string& key, ThreadPool::PRIORITY priority, TaskBase::Ptr task);
+  size_t key_num() const;
+  void Wait();
 
  private:
-  bool started_;
-  size_t thread_num_;
-  std::mutex mutex_;
+  /**
+   * @brief 队首任务完成, 投递同一 key 的下一个任务
+   */
+  void Next(const std::string& key);
+  void Dispatch(TaskBase::Ptr task, ThreadPool::PRIORITY priority);
+
+ private:
+  ThreadPool* pool_;
+  /**
+   * @brief 不为空时经由该执行器投递
+   */
+  std::shared_ptr<Executor::Impl> executor_;
+  mutable std::mutex mutex_;
+  /**
+   * @brief 所有 key 的任务都已完成时通知 Wait
+   */
+  std::condition_variable idle_cv_;
+  /**
+   * @brief 各 key 的任务, 队首为线程池中正在排队或执行的任务
+   */
+  std::unordered_map<std::string, std::deque<Entry> > queues_;
+};
+
+class TaskGraph::Impl : public std::enable_shared_from_this<TaskGraph::Impl> {
+  struct Node {
+    std::string Name;
+    std::function<void()> Func;
+    ThreadPool::PRIORITY Priority;
+    std::vector<NodeId> Predecessors;
+    std::vector<NodeId> Successors;
+  };
+
+  /**
+   * @brief 单次运行的状态, 各节点的时间只由该节点的任务写入
+   */
+  struct RunState {
+    int64_t Start = 0;
+    int64_t Done = 0;
+    /**
+     * @brief 各节点未结束的前驱数
+     */
+    std::unique_ptr<std::atomic<size_t>[]> Remaining;
+    /**
+     * @brief 各节点的开始与完成时间, 开始时间为 0 表示未执行
+     */
+    std::vector<int64_t> Starts;
+    std::vector<int64_t> Dones;
+    std::atomic<size_t> Unfinished{0};
+    std::atomic<bool> Failed{false};
+    std::mutex Mutex;
+    std::exception_ptr Error;
+    std::shared_ptr<Task<void> > Result;
+  };
+
+ public:
+  Impl(ThreadPool* pool);
+
+  NodeId AddNode(std::string name, std::function<void()> func, ThreadPool::PRIORITY priority);
+  bool AddEdge(NodeId from, NodeId to);
+  size_t node_num() const;
+  std::shared_ptr<Task<void> > Run();
+  bool GetReport(Report& report) const;
+
+ private:
+  bool Reachable(NodeId from, NodeId to) const;
+  void Dispatch(const std::shared_ptr<RunState>& run, NodeId id);
+  void Execute(RunState* run, NodeId id);
+  /**
+   * @brief 节点结束, 包括被跳过或未被线程池执行, 前驱都已结束的后继随即投递
+   */
+  void Complete(const std::shared_ptr<RunState>& run, NodeId id);
+  void Fail(RunState* run, std::exception_ptr error);
+  void Finish(const std::shared_ptr<RunState>& run);
+
+ private:
+  ThreadPool* pool_;
+  mutable std::mutex mutex_;
+  std::vector<Node> nodes_;
+  /**
+   * @brief 最近一次结束的运行
+   */
+  std::shared_ptr<RunState> last_;
+};
+
+class PipelineBase::Impl : public std::enable_shared_from_this<PipelineBase::Impl> {
+  struct Token {
+    size_t Slot;
+    /**
+     * @brief 提交顺序, IN_ORDER 阶段按此排序
+     */
+    uint64_t Seq;
+    /**
+     * @brief 已被前面的阶段丢弃, 只占用 IN_ORDER 阶段的顺序, 不再执行
+     */
+    bool Dropped;
+  };
+
+  struct Stage {
+    std::string Name;
+    MODE Mode;
+    size_t Parallelism;
+    std::function<bool(size_t)> Func;
+    size_t Running = 0;
+    /**
+     * @brief SERIAL 与 PARALLEL 阶段的缓冲, 先进先出
+     */
+    std::deque<Token> Buffer;
+    /**
+     * @brief IN_ORDER 阶段的缓冲, 按提交顺序排列
+     */
+    std::map<uint64_t, Token> Ordered;
+    /**
+     * @brief IN_ORDER 阶段下一个应处理的序号
+     */
+    uint64_t NextSeq = 0;
+    uint64_t Processed = 0;
+    uint64_t Dropped = 0;
+    uint64_t Errors = 0;
+    size_t MaxBuffered = 0;
+    uint64_t BusyTime = 0;
+  };
+
+ public:
+  Impl(PipelineBase* owner, ThreadPool* pool, size_t capacity);
+
+  void AddStage(std::string name, MODE mode, size_t parallelism, std::function<bool(size_t)> func);
+  bool Acquire(size_t& slot, bool wait);
+  void Submit(size_t slot);
+  void Wait();
+  size_t size() const;
+  std::vector<StageStats> GetStats() const;
+
+ private:
+  /**
+   * @brief 带着数据依次经过各阶段, admitted 为 true 时数据已占用 index 阶段
+   */
+  void Drive(Token token, size_t index, bool admitted);
+  /**
+   * @brief 阶段可以立即处理时占用阶段, 否则放入缓冲, 需持有 mutex_
+   */
+  bool Admit(Stage& stage, const Token& token);
+  /**
+   * @brief 阶段空出后取出缓冲中可以处理的数据并占用阶段, 需持有 mutex_
+   */
+  bool PopRunnable(Stage& stage, Token& token);
+  void Post(Token token, size_t index, bool admitted);
+  /**
+   * @brief 投递的任务未执行, 数据在 index 阶段被丢弃
+   */
+  void Abandon(Token token, size_t index, bool admitted);
+
+ private:
+  PipelineBase* owner_;
+  ThreadPool* pool_;
+  int64_t create_time_ns_;
+  mutable std::mutex mutex_;
   std::condition_variable cv_;
-  std::queue<TaskBase::Ptr> tasks_;
-  std::vector<std::thread> threads_;  
+  std::vector<std::unique_ptr<Stage> > stages_;
+  std::vector<size_t> free_;
+  size_t live_ = 0;
+  uint64_t next_seq_ = 0;
 };
 
 } // namespace seeker
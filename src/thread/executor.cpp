@@ -0,0 +1,222 @@
+#include "../thread.h"
+
+namespace seeker {
+
+Executor::Impl::Impl(ThreadPool* pool, std::string name, size_t quota, size_t capacity)
+    : pool_(pool),
+      name_(std::move(name)),
+      quota_(quota),
+      capacity_(capacity) {}
+
+void Executor::Impl::Submit(ThreadPool::PRIORITY priority, TaskBase::Ptr task) {
+  Admit(task);
+  Dispatch(priority, std::move(task));
+}
+
+void Executor::Impl::Admit(const TaskBase::Ptr& task) {
+  if (capacity_ == 0) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> l(mutex_);
+    // 线程池线程阻塞等待可能占满线程而无人消化积压, 时间轮线程阻塞会推迟所有定时器
+    if (backlog_ >= capacity_ && ThreadPool::Current() != pool_ && !TimerWheel::InTimerThread()) {
+      full_waiters_++;
+      full_cv_.wait(l, [&](){ return backlog_ < capacity_; });
+      full_waiters_--;
+    }
+    backlog_++;
+  }
+  task->OnDone([self = shared_from_this()](){
+    std::lock_guard<std::mutex> l(self->mutex_);
+    self->backlog_--;
+    if (self->full_waiters_ > 0) {
+      self->full_cv_.notify_one();
+    }
+  });
+}
+
+void Executor::Impl::Dispatch(ThreadPool::PRIORITY priority, TaskBase::Ptr task) {
+  // 拒绝、取消等未执行的情况同样会触发完成回调, 配额不会泄漏
+  task->OnDone([self = shared_from_this()](){
+    self->Next();
+  });
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (quota_ != 0 && running_ >= quota_) {
+      tasks_.Push(std::move(task), priority);
+      return;
+    }
+    running_++;
+  }
+  pool_->PushTask(std::move(task), priority);
+}
+
+void Executor::Impl::Next() {
+  TaskBase::Ptr next;
+  ThreadPool::PRIORITY priority;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!tasks_.Pop(next, priority)) {
+      running_--;
+      return;
+    }
+  }
+  pool_->PushTask(std::move(next), priority);
+}
+
+ThreadPool::TimerId Executor::Impl::ScheduleEvery(std::chrono::nanoseconds period,
+                                                  std::function<void()> func) {
+  auto timer = std::make_shared<Timer>();
+  auto id = pool_->impl_->timer().Add(period, period, [self = shared_from_this(), timer, func](){
+    {
+      std::lock_guard<std::mutex> l(timer->Mutex);
+      if (timer->Cancelled || timer->Running) {
+        return;
+      }
+      timer->Running = true;
+    }
+    auto task = std::make_shared<TaskBase>("ScheduleEvery", func);
+    task->OnDone([timer](){
+      std::lock_guard<std::mutex> l(timer->Mutex);
+      timer->Running = false;
+      timer->Cv.notify_all();
+    });
+    self->Submit(ThreadPool::NORMAL, std::move(task));
+  });
+  std::lock_guard<std::mutex> l(mutex_);
+  timers_.emplace(id, timer);
+  return id;
+}
+
+bool Executor::Impl::CancelTimer(ThreadPool::TimerId id) {
+  std::shared_ptr<Timer> timer;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto res = timers_.find(id);
+    if (res == timers_.end()) {
+      return false;
+    }
+    timer = std::move(res->second);
+    timers_.erase(res);
+  }
+  pool_->impl_->timer().Cancel(id);
+  // 时间轮线程可能正在投递, 以 Cancelled 挡住之后的触发, 再等待已投递的那次结束
+  std::unique_lock<std::mutex> l(timer->Mutex);
+  timer->Cancelled = true;
+  timer->Cv.wait(l, [&](){ return !timer->Running; });
+  return true;
+}
+
+size_t Executor::Impl::running() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return running_;
+}
+
+size_t Executor::Impl::pending() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return tasks_.size();
+}
+
+Executor::Executor(ThreadPool& pool, std::string name, size_t quota, size_t capacity)
+    : pool_(&pool),
+      impl_(std::make_shared<Impl>(&pool, std::move(name), quota, capacity)) {}
+
+Executor::~Executor() = default;
+
+void Executor::Submit(ThreadPool::PRIORITY priority, TaskBase::Ptr task) {
+  impl_->Submit(priority, std::move(task));
+}
+
+ThreadPool::TimerId Executor::ScheduleEvery(std::chrono::nanoseconds period,
+                                            std::function<void()> func) {
+  return impl_->ScheduleEvery(period, std::move(func));
+}
+
+bool Executor::CancelTimer(ThreadPool::TimerId id) {
+  return impl_->CancelTimer(id);
+}
+
+const std::string& Executor::name() const {
+  return impl_->name();
+}
+
+size_t Executor::quota() const {
+  return impl_->quota();
+}
+
+size_t Executor::capacity() const {
+  return impl_->capacity();
+}
+
+size_t Executor::running() const {
+  return impl_->running();
+}
+
+size_t Executor::pending() const {
+  return impl_->pending();
+}
+
+/**
+ * @brief 共享线程池的配置, 空闲时只保留 1 个线程, 繁忙时扩到 CPU 核数
+ */
+static ThreadPool::Option SharedPoolOption() {
+  auto cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  ThreadPool::Option option;
+  option.ThreadNum = 1;
+  option.MaxThreadNum = cores;
+  option.IdleTimeout = std::chrono::seconds(10);
+  // 文件读写等阻塞调用期间补偿线程, 不占用计算线程的名额
+  option.MaxBlockingNum = cores;
+  option.StallThreshold = std::chrono::seconds(5);
+  option.RecordCpuTime = true;
+  return option;
+}
+
+ExecutorRegistry::Impl::Impl()
+    : pool_(SharedPoolOption()) {
+  pool_.Start();
+}
+
+Executor::Ptr ExecutorRegistry::Impl::Get(const std::string& name, size_t quota, size_t capacity) {
+  std::lock_guard<std::mutex> l(mutex_);
+  auto& executor = executors_[name];
+  if (!executor) {
+    executor = std::make_shared<Executor>(pool_, name, quota, capacity);
+  }
+  return executor;
+}
+
+std::vector<Executor::Ptr> ExecutorRegistry::Impl::List() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  std::vector<Executor::Ptr> executors;
+  executors.reserve(executors_.size());
+  for (auto& item : executors_) {
+    executors.push_back(item.second);
+  }
+  return executors;
+}
+
+ExecutorRegistry& ExecutorRegistry::GetInstance() {
+  static auto registry = new ExecutorRegistry;
+  return *registry;
+}
+
+ExecutorRegistry::ExecutorRegistry()
+    : impl_(std::make_unique<Impl>()) {}
+
+ExecutorRegistry::~ExecutorRegistry() = default;
+
+Executor::Ptr ExecutorRegistry::Get(const std::string& name, size_t quota, size_t capacity) {
+  return impl_->Get(name, quota, capacity);
+}
+
+std::vector<Executor::Ptr> ExecutorRegistry::List() const {
+  return impl_->List();
+}
+
+ThreadPool& ExecutorRegistry::pool() {
+  return impl_->pool();
+}
+
+} // namespace seeker
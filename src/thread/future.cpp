@@ -0,0 +1,70 @@
+#include "../../include/future.hpp"
+
+#include <time.h>
+#include <climits>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "util.h"
+#include "../thread.h"
+
+#define SPIN_NUM    128
+
+namespace seeker {
+
+static inline long Futex(std::atomic<uint32_t>* word, int op, uint32_t value,
+                         const timespec* timeout = nullptr) {
+  return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+void FutureStateBase::Wait() const {
+  if (ready()) {
+    return;
+  }
+  // 线程池线程先执行其他排队任务, 避免线程都阻塞在等待上
+  ThreadPool::Impl::HelpWhile([this]() {
+    return !ready();
+  });
+  auto state = state_.load(std::memory_order_acquire);
+  // 小任务往往很快完成, 先自旋避免进入内核
+  for (int i = 0; !(state & READY) && i < SPIN_NUM; i++) {
+    util::CpuRelax();
+    state = state_.load(std::memory_order_acquire);
+  }
+  while (!(state & READY)) {
+    if (!(state & WAITING) &&
+        !state_.compare_exchange_weak(state, state | WAITING, std::memory_order_acquire)) {
+      continue;
+    }
+    Futex(&state_, FUTEX_WAIT_PRIVATE, state | WAITING);
+    state = state_.load(std::memory_order_acquire);
+  }
+}
+
+bool FutureStateBase::WaitFor(std::chrono::nanoseconds timeout) const {
+  auto deadline = util::GetSteadyTimeNs() + timeout.count();
+  auto state = state_.load(std::memory_order_acquire);
+  while (!(state & READY)) {
+    auto remaining = deadline - util::GetSteadyTimeNs();
+    if (remaining <= 0) {
+      return false;
+    }
+    if (!(state & WAITING) &&
+        !state_.compare_exchange_weak(state, state | WAITING, std::memory_order_acquire)) {
+      continue;
+    }
+    timespec ts{ static_cast<time_t>(remaining / 1000000000), static_cast<long>(remaining % 1000000000) };
+    Futex(&state_, FUTEX_WAIT_PRIVATE, state | WAITING, &ts);
+    state = state_.load(std::memory_order_acquire);
+  }
+  return true;
+}
+
+void FutureStateBase::Publish() {
+  if (state_.exchange(READY, std::memory_order_acq_rel) & WAITING) {
+    Futex(&state_, FUTEX_WAKE_PRIVATE, INT_MAX);
+  }
+}
+
+} // namespace seeker
@@ -0,0 +1,71 @@
+#include "histogram.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace seeker {
+
+void Histogram::Record(uint64_t value) {
+  buckets_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  auto max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+void Histogram::Snapshot(HistogramSnapshot& snapshot) const {
+  // 各计数器分别读取, 并发记录时快照内部可能有细微出入
+  snapshot.Buckets.resize(HISTOGRAM_BUCKET_NUM);
+  uint64_t count = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKET_NUM; i++) {
+    snapshot.Buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    count += snapshot.Buckets[i];
+  }
+  snapshot.Count = count;
+  snapshot.Sum = sum_.load(std::memory_order_relaxed);
+  snapshot.Max = max_.load(std::memory_order_relaxed);
+}
+
+size_t Histogram::BucketOf(uint64_t value) {
+  if (value < HISTOGRAM_SUB_SIZE) {
+    return value;
+  }
+  size_t exp = 63 - __builtin_clzll(value);
+  if (exp >= HISTOGRAM_MAX_BITS) {
+    return HISTOGRAM_BUCKET_NUM - 1;
+  }
+  auto sub = (value >> (exp - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_SIZE - 1);
+  return (exp - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_SIZE + sub;
+}
+
+uint64_t Histogram::UpperBound(size_t bucket) {
+  if (bucket < HISTOGRAM_SUB_SIZE) {
+    return bucket;
+  }
+  auto exp = bucket / HISTOGRAM_SUB_SIZE + HISTOGRAM_SUB_BITS - 1;
+  auto sub = bucket % HISTOGRAM_SUB_SIZE;
+  auto width = 1ULL << (exp - HISTOGRAM_SUB_BITS);
+  return ((HISTOGRAM_SUB_SIZE + sub) << (exp - HISTOGRAM_SUB_BITS)) + width - 1;
+}
+
+uint64_t HistogramSnapshot::Percentile(double percent) const {
+  if (Count == 0) {
+    return 0;
+  }
+  auto target = static_cast<uint64_t>(std::ceil(std::min(percent, 100.0) / 100.0 * Count));
+  target = std::max<uint64_t>(target, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < Buckets.size(); i++) {
+    seen += Buckets[i];
+    if (seen >= target) {
+      return std::min(Histogram::UpperBound(i), Max);
+    }
+  }
+  return Max;
+}
+
+double HistogramSnapshot::Mean() const {
+  return Count ? static_cast<double>(Sum) / Count : 0;
+}
+
+} // namespace seeker
@@ -0,0 +1,52 @@
+/*
+ * @Author: zyxeeker zyxeeker@gmail.com
+ * @Date: 2026-10-18 17:10:40
+ * @LastEditors: zyxeeker zyxeeker@gmail.com
+ * @LastEditTime: 2026-10-18 17:10:40
+ * @Description: 耗时直方图
+ */
+
+#ifndef __SEEKER_SRC_THREAD_HISTOGRAM_H__
+#define __SEEKER_SRC_THREAD_HISTOGRAM_H__
+
+#include <atomic>
+
+#include "../../include/thread.hpp"
+
+/**
+ * @brief 每个 2 的幂区间细分的桶数为 2^SUB_BITS, 相对误差不超过 1/16
+ */
+#define HISTOGRAM_SUB_BITS      4
+#define HISTOGRAM_SUB_SIZE      (1 << HISTOGRAM_SUB_BITS)
+/**
+ * @brief 可区分的最大值为 2^42 ns, 约 73 分钟, 更大的值计入最后一个桶
+ */
+#define HISTOGRAM_MAX_BITS      42
+#define HISTOGRAM_BUCKET_NUM    ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_SIZE)
+
+namespace seeker {
+
+/**
+ * @brief HDR 风格的对数分桶直方图, 记录只有几次 relaxed 原子操作, 可多线程并发记录
+ */
+class Histogram {
+ public:
+  void Record(uint64_t value);
+  void Snapshot(HistogramSnapshot& snapshot) const;
+
+  static size_t BucketOf(uint64_t value);
+  /**
+   * @brief 桶内的最大值
+   */
+  static uint64_t UpperBound(size_t bucket);
+
+ private:
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+  std::atomic<uint64_t> buckets_[HISTOGRAM_BUCKET_NUM] = {};
+};
+
+} // namespace seeker
+
+#endif // __SEEKER_SRC_THREAD_HISTOGRAM_H__
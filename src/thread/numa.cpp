@@ -0,0 +1,118 @@
+#include "numa.h"
+
+#include <sched.h>
+#include <dirent.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+
+#define NODE_PATH     "/sys/devices/system/node"
+
+namespace seeker {
+
+const NumaTopology& NumaTopology::GetInstance() {
+  static NumaTopology topology;
+  return topology;
+}
+
+NumaTopology::NumaTopology() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    CPU_ZERO(&allowed);
+  }
+
+  std::vector<int> ids;
+  if (auto dir = opendir(NODE_PATH)) {
+    while (auto entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (name.compare(0, 4, "node") == 0 && name.size() > 4 &&
+          std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+        ids.push_back(std::atoi(name.c_str() + 4));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(ids.begin(), ids.end());
+
+  for (auto id : ids) {
+    std::ifstream file(NODE_PATH "/node" + std::to_string(id) + "/cpulist");
+    std::string list;
+    if (!std::getline(file, list)) {
+      continue;
+    }
+    std::vector<int> cpus;
+    for (auto cpu : ParseCpuList(list)) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    // 没有可用 CPU 的节点(如纯内存节点)不参与调度
+    if (!cpus.empty()) {
+      nodes_.push_back(std::move(cpus));
+    }
+  }
+
+  if (nodes_.empty()) {
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    if (cpus.empty()) {
+      cpus.push_back(0);
+    }
+    nodes_.push_back(std::move(cpus));
+  }
+
+  for (size_t node = 0; node < nodes_.size(); node++) {
+    for (auto cpu : nodes_[node]) {
+      auto index = static_cast<size_t>(cpu);
+      if (cpu_node_.size() <= index) {
+        cpu_node_.resize(index + 1, 0);
+      }
+      cpu_node_[index] = node;
+    }
+  }
+}
+
+size_t NumaTopology::NodeOfCpu(int cpu) const {
+  if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_node_.size()) {
+    return 0;
+  }
+  return cpu_node_[static_cast<size_t>(cpu)];
+}
+
+size_t NumaTopology::CurrentNode() const {
+  if (nodes_.size() == 1) {
+    return 0;
+  }
+  return NodeOfCpu(sched_getcpu());
+}
+
+std::vector<int> NumaTopology::ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    auto end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    auto range = list.substr(pos, end - pos);
+    pos = end + 1;
+    if (range.empty() || !::isdigit(range[0])) {
+      continue;
+    }
+    auto dash = range.find('-');
+    int first = std::atoi(range.c_str());
+    int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+} // namespace seeker
@@ -0,0 +1,61 @@
+/*
+ * @Author: zyxeeker zyxeeker@gmail.com
+ * @Date: 2026-10-18 16:05:12
+ * @LastEditors: zyxeeker zyxeeker@gmail.com
+ * @LastEditTime: 2026-10-18 16:05:12
+ * @Description: NUMA 拓扑
+ */
+
+#ifndef __SEEKER_SRC_THREAD_NUMA_H__
+#define __SEEKER_SRC_THREAD_NUMA_H__
+
+#include <vector>
+#include <string>
+
+namespace seeker {
+
+/**
+ * @brief 从 /sys/devices/system/node 读取的 NUMA 拓扑, 只保留进程允许运行的 CPU
+ * 读取失败或不支持 NUMA 时视为只有一个节点
+ */
+class NumaTopology {
+ public:
+  static const NumaTopology& GetInstance();
+
+  inline size_t node_num() const {
+    return nodes_.size();
+  }
+  /**
+   * @brief 节点上可用的 CPU
+   */
+  inline const std::vector<int>& cpus(size_t node) const {
+    return nodes_[node];
+  }
+  /**
+   * @brief CPU 所在节点, 未知的 CPU 返回 0
+   */
+  size_t NodeOfCpu(int cpu) const;
+  /**
+   * @brief 当前线程所在节点
+   */
+  size_t CurrentNode() const;
+
+  /**
+   * @brief 解析 "0-3,8-11" 格式的 CPU 列表
+   */
+  static std::vector<int> ParseCpuList(const std::string& list);
+
+ private:
+  NumaTopology();
+
+ private:
+  std::vector<std::vector<int> > nodes_;
+  /**
+   * @brief 以 CPU 编号为下标的节点号
+   */
+  std::vector<size_t> cpu_node_;
+};
+
+} // namespace seeker
+
+#endif // __SEEKER_SRC_THREAD_NUMA_H__
@@ -0,0 +1,87 @@
+#include "task_queue.h"
+
+namespace seeker {
+
+/**
+ * @brief 每轮各通道可出队的次数, 高:普通:后台 = 16:4:1
+ */
+static const size_t LANE_WEIGHTS[PRIORITY_NUM] = { 16, 4, 1 };
+
+TaskQueue::TaskQueue()
+    : size_(0) {
+  for (auto i = 0; i < PRIORITY_NUM; i++) {
+    credits_[i] = LANE_WEIGHTS[i];
+  }
+}
+
+void TaskQueue::Push(TaskBase::Ptr&& task, ThreadPool::PRIORITY priority) {
+  lanes_[priority].push_back(std::move(task));
+  ++size_;
+}
+
+bool TaskQueue::Pop(TaskBase::Ptr& task, ThreadPool::PRIORITY& priority) {
+  if (size_ == 0) {
+    return false;
+  }
+  for (;;) {
+    for (auto i = 0; i < PRIORITY_NUM; i++) {
+      if (lanes_[i].empty() || credits_[i] == 0) {
+        continue;
+      }
+      --credits_[i];
+      task = std::move(lanes_[i].front());
+      lanes_[i].pop_front();
+      --size_;
+      priority = static_cast<ThreadPool::PRIORITY>(i);
+      return true;
+    }
+    // 所有非空通道的次数都已用完, 开始新的一轮
+    for (auto i = 0; i < PRIORITY_NUM; i++) {
+      credits_[i] = LANE_WEIGHTS[i];
+    }
+  }
+}
+
+bool TaskQueue::PopOldest(TaskBase::Ptr& task, ThreadPool::PRIORITY& priority) {
+  for (auto i = PRIORITY_NUM - 1; i >= 0; i--) {
+    if (lanes_[i].empty()) {
+      continue;
+    }
+    task = std::move(lanes_[i].front());
+    lanes_[i].pop_front();
+    --size_;
+    priority = static_cast<ThreadPool::PRIORITY>(i);
+    return true;
+  }
+  return false;
+}
+
+bool TaskQueue::PopNewest(TaskBase::Ptr& task, ThreadPool::PRIORITY& priority) {
+  for (auto i = 0; i < PRIORITY_NUM; i++) {
+    if (lanes_[i].empty()) {
+      continue;
+    }
+    task = std::move(lanes_[i].back());
+    lanes_[i].pop_back();
+    --size_;
+    priority = static_cast<ThreadPool::PRIORITY>(i);
+    return true;
+  }
+  return false;
+}
+
+int64_t TaskQueue::OldestEnqueueTimeNs() const {
+  int64_t oldest = 0;
+  for (auto i = 0; i < PRIORITY_NUM; i++) {
+    if (lanes_[i].empty()) {
+      continue;
+    }
+    auto time = lanes_[i].front()->enqueue_time_ns();
+    if (oldest == 0 || time < oldest) {
+      oldest = time;
+    }
+  }
+  return oldest;
+}
+
+} // namespace seeker
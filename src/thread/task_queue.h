@@ -0,0 +1,61 @@
+/*
+ * @Author: zyxeeker zyxeeker@gmail.com
+ * @Date: 2026-10-18 11:02:41
+ * @LastEditors: zyxeeker zyxeeker@gmail.com
+ * @LastEditTime: 2026-10-18 11:02:41
+ * @Description: 分优先级的任务队列
+ */
+
+#ifndef __SEEKER_SRC_THREAD_TASK_QUEUE_H__
+#define __SEEKER_SRC_THREAD_TASK_QUEUE_H__
+
+#include <deque>
+
+#include "../../include/thread.hpp"
+
+#define PRIORITY_NUM    3
+
+namespace seeker {
+
+/**
+ * @brief 分优先级的任务队列, 按权重轮转出队, 低优先级不会被饿死
+ * 队列本身不加锁, 由持有者保护
+ */
+class TaskQueue {
+ public:
+  TaskQueue();
+
+  void Push(TaskBase::Ptr&& task, ThreadPool::PRIORITY priority);
+  bool Pop(TaskBase::Ptr& task, ThreadPool::PRIORITY& priority);
+  /**
+   * @brief 取出最低优先级通道中排队最久的任务, 用于队列满时丢弃
+   */
+  bool PopOldest(TaskBase::Ptr& task, ThreadPool::PRIORITY& priority);
+  /**
+   * @brief 取出最高优先级通道中最新的任务, 用于等待方协助执行, 使嵌套的子任务深度优先
+   */
+  bool PopNewest(TaskBase::Ptr& task, ThreadPool::PRIORITY& priority);
+  /**
+   * @brief 排队最久的任务的入队时间, 队列为空时返回 0
+   */
+  int64_t OldestEnqueueTimeNs() const;
+
+  inline bool empty() const {
+    return size_ == 0;
+  }
+  inline size_t size() const {
+    return size_;
+  }
+
+ private:
+  std::deque<TaskBase::Ptr> lanes_[PRIORITY_NUM];
+  /**
+   * @brief 每轮剩余的出队次数
+   */
+  size_t credits_[PRIORITY_NUM];
+  size_t size_;
+};
+
+} // namespace seeker
+
+#endif // __SEEKER_SRC_THREAD_TASK_QUEUE_H__
@@ -0,0 +1,224 @@
+#include "timer_wheel.h"
+
+#include <iostream>
+
+#define LEVEL_NUM           4
+#define ROOT_BITS           8
+#define LEVEL_BITS          6
+#define ROOT_SIZE           (1 << ROOT_BITS)
+#define LEVEL_SIZE          (1 << LEVEL_BITS)
+#define LEVEL_SHIFT(L)      (ROOT_BITS + LEVEL_BITS * ((L) - 1))
+#define MAX_TICKS           ((1ULL << LEVEL_SHIFT(LEVEL_NUM)) - 1)
+
+namespace seeker {
+
+thread_local bool TimerWheel::in_timer_ = false;
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : tick_(tick) {
+  levels_.emplace_back(ROOT_SIZE);
+  for (auto i = 1; i < LEVEL_NUM; i++) {
+    levels_.emplace_back(LEVEL_SIZE);
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  Stop();
+}
+
+uint64_t TimerWheel::Add(std::chrono::nanoseconds delay, std::chrono::nanoseconds period,
+                         std::function<void()> func) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (!started_) {
+    started_ = true;
+    base_ = std::chrono::steady_clock::now();
+    current_ = 0;
+    thread_ = std::thread(&TimerWheel::Loop, this);
+  }
+  auto now = ToTicks(std::chrono::steady_clock::now() - base_);
+  if (index_.empty()) {
+    // 没有定时器时时间轮可能停在旧的刻度上, 直接追到当前时间
+    current_ = std::max(current_, now);
+  }
+
+  Slot slot;
+  slot.push_back({ next_id_++,
+                   std::max(now, current_) + std::max<uint64_t>(ToTicks(delay), 1),
+                   period.count() > 0 ? std::max<uint64_t>(ToTicks(period), 1) : 0,
+                   std::move(func) });
+  auto id = slot.front().Id;
+  Place(slot, slot.begin());
+  cv_.notify_one();
+  return id;
+}
+
+bool TimerWheel::Cancel(uint64_t id) {
+  std::lock_guard<std::mutex> l(mutex_);
+  auto res = index_.find(id);
+  if (res == index_.end()) {
+    return false;
+  }
+  // 正在执行回调的定时器由时间轮线程回收
+  if (res->second.Level >= 0) {
+    levels_[res->second.Level][res->second.Index].erase(res->second.Iter);
+  }
+  index_.erase(res);
+  return true;
+}
+
+void TimerWheel::Stop() {
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!started_) {
+      return;
+    }
+    started_ = false;
+    cv_.notify_all();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  // 未到期的回调在锁外析构, 其捕获的对象析构时可能再次添加定时器
+  Slot discarded;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    for (auto& level : levels_) {
+      for (auto& slot : level) {
+        discarded.splice(discarded.end(), slot);
+      }
+    }
+    index_.clear();
+  }
+}
+
+uint64_t TimerWheel::ToTicks(std::chrono::nanoseconds duration) const {
+  return (duration.count() + tick_.count() - 1) / tick_.count();
+}
+
+void TimerWheel::Place(Slot& from, Slot::iterator iter) {
+  auto expire = iter->Expire;
+  auto diff = expire > current_ ? expire - current_ : 0;
+  int level = 0;
+  size_t index = 0;
+  if (diff < ROOT_SIZE) {
+    index = expire & (ROOT_SIZE - 1);
+  } else {
+    if (diff > MAX_TICKS) {
+      // 超出时间轮范围, 先放在最高层, 下放时重新计算
+      expire = current_ + MAX_TICKS;
+      diff = MAX_TICKS;
+    }
+    for (level = 1; level < LEVEL_NUM - 1; level++) {
+      if (diff < (1ULL << LEVEL_SHIFT(level + 1))) {
+        break;
+      }
+    }
+    index = (expire >> LEVEL_SHIFT(level)) & (LEVEL_SIZE - 1);
+  }
+  auto& slot = levels_[level][index];
+  slot.splice(slot.end(), from, iter);
+  index_[iter->Id] = { level, index, iter };
+}
+
+void TimerWheel::Cascade(int level, size_t index) {
+  Slot slot;
+  slot.swap(levels_[level][index]);
+  while (!slot.empty()) {
+    Place(slot, slot.begin());
+  }
+}
+
+void TimerWheel::Advance(Slot& expired) {
+  ++current_;
+  auto index = current_ & (ROOT_SIZE - 1);
+  for (int level = 1; index == 0 && level < LEVEL_NUM; level++) {
+    index = (current_ >> LEVEL_SHIFT(level)) & (LEVEL_SIZE - 1);
+    Cascade(level, index);
+  }
+
+  auto& slot = levels_[0][current_ & (ROOT_SIZE - 1)];
+  while (!slot.empty()) {
+    auto iter = slot.begin();
+    if (iter->Expire > current_) {
+      Place(slot, iter);
+      continue;
+    }
+    expired.splice(expired.end(), slot, iter);
+    index_[iter->Id].Level = -1;
+  }
+}
+
+uint64_t TimerWheel::NextExpire() const {
+  uint64_t next = 0;
+  for (auto& slot : levels_[0]) {
+    for (auto& node : slot) {
+      if (next == 0 || node.Expire < next) {
+        next = node.Expire;
+      }
+    }
+  }
+  if (next != 0) {
+    return std::max(next, current_ + 1);
+  }
+  // 只有高层的定时器, 到下一次下放时再醒
+  return (current_ | (ROOT_SIZE - 1)) + 1;
+}
+
+bool TimerWheel::InTimerThread() {
+  return in_timer_;
+}
+
+void TimerWheel::Loop() {
+  in_timer_ = true;
+  std::unique_lock<std::mutex> l(mutex_);
+  while (started_) {
+    if (index_.empty()) {
+      cv_.wait(l, [&](){ return !started_ || !index_.empty(); });
+      continue;
+    }
+    auto now = ToTicks(std::chrono::steady_clock::now() - base_);
+    if (current_ >= now) {
+      cv_.wait_until(l, base_ + tick_ * NextExpire());
+      continue;
+    }
+
+    Slot expired;
+    while (current_ < now) {
+      Advance(expired);
+    }
+    if (expired.empty()) {
+      continue;
+    }
+
+    l.unlock();
+    for (auto& node : expired) {
+      try {
+        node.Func();
+      } catch (const std::exception& e) {
+        std::cout << "Caught exception in timer "
+                     "[" << node.Id << "] meaning "
+                     "[" << e.what() << "]\n";
+      } catch (...) {
+        std::cout << "Caught unknown exception in timer "
+                     "[" << node.Id << "]\n";
+      }
+    }
+    l.lock();
+
+    while (!expired.empty()) {
+      auto iter = expired.begin();
+      auto res = index_.find(iter->Id);
+      if (res == index_.end()) {
+        expired.pop_front();
+      } else if (iter->Period == 0) {
+        index_.erase(res);
+        expired.pop_front();
+      } else {
+        iter->Expire = current_ + iter->Period;
+        Place(expired, iter);
+      }
+    }
+  }
+}
+
+} // namespace seeker
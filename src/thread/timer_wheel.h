@@ -0,0 +1,105 @@
+/*
+ * @Author: zyxeeker zyxeeker@gmail.com
+ * @Date: 2026-10-18 10:12:30
+ * @LastEditors: zyxeeker zyxeeker@gmail.com
+ * @LastEditTime: 2026-10-18 10:12:30
+ * @Description: 分层时间轮
+ */
+
+#ifndef __SEEKER_SRC_THREAD_TIMER_WHEEL_H__
+#define __SEEKER_SRC_THREAD_TIMER_WHEEL_H__
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+namespace seeker {
+
+/**
+ * @brief 分层时间轮, 所有定时器共用一个线程, 插入与取消均为 O(1)
+ * 第 0 层 256 个槽, 其余 3 层各 64 个槽, 1ms 精度下可覆盖约 18 小时, 更远的定时器逐层下放
+ */
+class TimerWheel {
+  struct Node {
+    uint64_t Id;
+    /**
+     * @brief 到期的刻度
+     */
+    uint64_t Expire;
+    /**
+     * @brief 周期刻度数, 0 表示只执行一次
+     */
+    uint64_t Period;
+    std::function<void()> Func;
+  };
+  using Slot = std::list<Node>;
+
+  struct Location {
+    /**
+     * @brief 所在层, -1 表示正在执行回调
+     */
+    int Level;
+    size_t Index;
+    Slot::iterator Iter;
+  };
+
+ public:
+  TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(1));
+  ~TimerWheel();
+
+  /**
+   * @brief 添加定时器, 回调在时间轮线程上执行, 不应阻塞
+   * @param delay 首次触发的延迟, 向上取整到刻度
+   * @param period 触发周期, 0 表示只执行一次
+   * @return uint64_t 定时器 ID
+   */
+  uint64_t Add(std::chrono::nanoseconds delay, std::chrono::nanoseconds period,
+               std::function<void()> func);
+  /**
+   * @brief 取消定时器
+   */
+  bool Cancel(uint64_t id);
+  /**
+   * @brief 停止时间轮线程并清除全部定时器
+   */
+  void Stop();
+  /**
+   * @brief 当前线程是否为某个时间轮的线程, 其上的回调不应阻塞或执行耗时操作
+   */
+  static bool InTimerThread();
+
+ private:
+  uint64_t ToTicks(std::chrono::nanoseconds duration) const;
+  void Place(Slot& from, Slot::iterator iter);
+  void Cascade(int level, size_t index);
+  void Advance(Slot& expired);
+  /**
+   * @brief 下一次需要醒来的刻度: 第 0 层最早的到期刻度, 第 0 层为空时为下一次从高层下放的刻度
+   */
+  uint64_t NextExpire() const;
+  void Loop();
+
+ private:
+  std::chrono::nanoseconds tick_;
+  std::chrono::steady_clock::time_point base_;
+  bool started_ = false;
+  uint64_t current_ = 0;
+  uint64_t next_id_ = 1;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::vector<Slot> > levels_;
+  std::unordered_map<uint64_t, Location> index_;
+  std::thread thread_;
+
+  static thread_local bool in_timer_;
+};
+
+} // namespace seeker
+
+#endif // __SEEKER_SRC_THREAD_TIMER_WHEEL_H__
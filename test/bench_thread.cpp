@@ -0,0 +1,303 @@
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include <nlohmann/json.hpp>
+
+#include "thread.hpp"
+
+/**
+ * @brief 线程池微基准, 结果以 JSON 输出到标准输出或 --out 指定的文件, 便于跨提交对比
+ * 用法: Seeker_bench_thread [--quick] [--out file], 应以 -DCMAKE_BUILD_TYPE=Release 构建
+ */
+
+struct BenchConfig {
+  bool Quick = false;
+  std::string Out;
+  size_t Cores = 1;
+};
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char* ModeName(seeker::ThreadPool::MODE mode) {
+  return mode == seeker::ThreadPool::SHARED_QUEUE ? "SHARED_QUEUE" : "WORK_STEALING";
+}
+
+/**
+ * @brief 样本的百分位, 单位 ns
+ */
+static nlohmann::json Percentiles(std::vector<int64_t>& samples) {
+  nlohmann::json json;
+  if (samples.empty()) {
+    return json;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double percent) {
+    auto index = static_cast<size_t>(percent / 100 * (samples.size() - 1));
+    return samples[index];
+  };
+  json["samples"] = samples.size();
+  json["p50_ns"] = at(50);
+  json["p90_ns"] = at(90);
+  json["p99_ns"] = at(99);
+  json["p999_ns"] = at(99.9);
+  json["max_ns"] = samples.back();
+  return json;
+}
+
+static seeker::ThreadPool::Option PoolOption(seeker::ThreadPool::MODE mode, size_t thread_num) {
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = thread_num;
+  option.Mode = mode;
+  // 统计本身有开销, 基准只测调度路径
+  option.RecordLatency = false;
+  return option;
+}
+
+/**
+ * @brief 多个生产者并发提交空任务, 计时到全部执行完
+ */
+static void BenchSubmitThroughput(const BenchConfig& config, nlohmann::json& results) {
+  const size_t total = config.Quick ? 100000 : 1000000;
+  std::vector<size_t> producers;
+  for (size_t num = 1; num <= std::max<size_t>(config.Cores, 4); num *= 2) {
+    producers.push_back(num);
+  }
+  for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+    for (auto producer_num : producers) {
+      seeker::ThreadPool tp(PoolOption(mode, config.Cores));
+      tp.Start();
+      std::atomic<size_t> done{0};
+      auto per_producer = total / producer_num;
+      auto begin = NowNs();
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < producer_num; i++) {
+        threads.emplace_back([&]() {
+          for (size_t j = 0; j < per_producer; j++) {
+            tp.Post("BENCH", [&done]() {
+              done.fetch_add(1, std::memory_order_relaxed);
+            });
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      auto submitted = NowNs();
+      while (done.load() < per_producer * producer_num) {
+        std::this_thread::yield();
+      }
+      auto end = NowNs();
+      tp.Stop();
+      auto tasks = per_producer * producer_num;
+      results.push_back({
+        { "name", "submit_throughput" },
+        { "mode", ModeName(mode) },
+        { "producers", producer_num },
+        { "tasks", tasks },
+        { "submit_ns", submitted - begin },
+        { "total_ns", end - begin },
+        { "tasks_per_sec", tasks * 1e9 / std::max<int64_t>(end - begin, 1) },
+      });
+    }
+  }
+}
+
+/**
+ * @brief 提交到开始执行的延迟: idle 为线程池空闲时逐个提交, 含唤醒开销; burst 为一次提交一批
+ */
+static void BenchSubmitLatency(const BenchConfig& config, nlohmann::json& results) {
+  const size_t rounds = config.Quick ? 2000 : 20000;
+  const size_t burst = 64;
+  for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+    seeker::ThreadPool tp(PoolOption(mode, config.Cores));
+    tp.Start();
+    std::vector<int64_t> idle;
+    idle.reserve(rounds);
+    for (size_t i = 0; i < rounds; i++) {
+      auto task = tp.CreateTask("BENCH", []() {});
+      task->result().get();
+      idle.push_back(task->start_time_ns() - task->enqueue_time_ns());
+    }
+    std::vector<int64_t> loaded;
+    loaded.reserve(rounds);
+    for (size_t i = 0; i < rounds / burst; i++) {
+      std::vector<std::shared_ptr<seeker::Task<void> > > tasks;
+      for (size_t j = 0; j < burst; j++) {
+        tasks.push_back(tp.CreateTask("BENCH", []() {}));
+      }
+      for (auto& task : tasks) {
+        task->result().get();
+        loaded.push_back(task->start_time_ns() - task->enqueue_time_ns());
+      }
+    }
+    tp.Stop();
+    auto idle_json = Percentiles(idle);
+    idle_json["name"] = "submit_to_start_latency";
+    idle_json["mode"] = ModeName(mode);
+    idle_json["load"] = "idle";
+    results.push_back(idle_json);
+    auto burst_json = Percentiles(loaded);
+    burst_json["name"] = "submit_to_start_latency";
+    burst_json["mode"] = ModeName(mode);
+    burst_json["load"] = "burst";
+    burst_json["burst"] = burst;
+    results.push_back(burst_json);
+  }
+}
+
+/**
+ * @brief 派生 width 个空任务并以 WhenAll 汇合, 分别测逐个提交与批量提交
+ */
+static void BenchFanOutFanIn(const BenchConfig& config, nlohmann::json& results) {
+  const size_t rounds = config.Quick ? 200 : 2000;
+  for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+    for (size_t width : { 16, 256 }) {
+      for (bool batch : { false, true }) {
+        seeker::ThreadPool tp(PoolOption(mode, config.Cores));
+        tp.Start();
+        std::vector<int> items(width);
+        std::vector<int64_t> samples;
+        samples.reserve(rounds);
+        for (size_t i = 0; i < rounds; i++) {
+          auto begin = NowNs();
+          std::vector<seeker::TaskBase::Ptr> tasks;
+          if (batch) {
+            for (auto& task : tp.CreateTasks("BENCH", items.begin(), items.end(), [](int) {})) {
+              tasks.push_back(task);
+            }
+          } else {
+            for (size_t j = 0; j < width; j++) {
+              tasks.push_back(tp.CreateTask("BENCH", []() {}));
+            }
+          }
+          tp.WhenAll(tasks)->result().get();
+          samples.push_back(NowNs() - begin);
+        }
+        tp.Stop();
+        auto json = Percentiles(samples);
+        json["name"] = "fan_out_fan_in";
+        json["mode"] = ModeName(mode);
+        json["width"] = width;
+        json["submit"] = batch ? "batch" : "single";
+        results.push_back(json);
+      }
+    }
+  }
+}
+
+/**
+ * @brief result().get() 的开销: ready 为结果已就绪时的单次取值, round_trip 为提交到取回结果
+ */
+static void BenchResultGet(const BenchConfig& config, nlohmann::json& results) {
+  const size_t count = config.Quick ? 20000 : 200000;
+  seeker::ThreadPool tp(PoolOption(seeker::ThreadPool::SHARED_QUEUE, config.Cores));
+  tp.Start();
+
+  std::vector<std::shared_ptr<seeker::Task<int> > > tasks;
+  tasks.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    tasks.push_back(tp.CreateTask("BENCH", [](int x) { return x; }, static_cast<int>(i)));
+  }
+  tp.WhenAll(std::vector<seeker::TaskBase::Ptr>(tasks.begin(), tasks.end()))->result().get();
+  int64_t sum = 0;
+  auto begin = NowNs();
+  for (auto& task : tasks) {
+    sum += task->result().get();
+  }
+  auto task_ready = NowNs() - begin;
+
+  auto shared = tp.CreateSharedTask("BENCH", []() { return 1; });
+  shared->result().get();
+  begin = NowNs();
+  for (size_t i = 0; i < count; i++) {
+    sum += shared->result().get();
+  }
+  auto shared_ready = NowNs() - begin;
+
+  const size_t trips = count / 10;
+  begin = NowNs();
+  for (size_t i = 0; i < trips; i++) {
+    sum += tp.CreateTask("BENCH", []() { return 1; })->result().get();
+  }
+  auto task_trip = NowNs() - begin;
+  begin = NowNs();
+  for (size_t i = 0; i < trips; i++) {
+    sum += tp.CreateSharedTask("BENCH", []() { return 1; })->result().get();
+  }
+  auto shared_trip = NowNs() - begin;
+  tp.Stop();
+
+  auto push = [&](const char* type, const char* phase, size_t ops, int64_t ns) {
+    results.push_back({
+      { "name", "result_get" },
+      { "task", type },
+      { "phase", phase },
+      { "ops", ops },
+      { "ns_per_op", static_cast<double>(ns) / ops },
+    });
+  };
+  push("Task", "ready", count, task_ready);
+  push("SharedTask", "ready", count, shared_ready);
+  push("Task", "round_trip", trips, task_trip);
+  push("SharedTask", "round_trip", trips, shared_trip);
+  // 防止取值被优化掉
+  if (sum == 0) {
+    std::cerr << "unexpected checksum" << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  BenchConfig config;
+  config.Cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--quick") {
+      config.Quick = true;
+    } else if (arg == "--out" && i + 1 < argc) {
+      config.Out = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--quick] [--out file]" << std::endl;
+      return 1;
+    }
+  }
+
+  nlohmann::json report;
+  report["benchmark"] = "thread";
+  report["cores"] = config.Cores;
+  report["quick"] = config.Quick;
+#if defined(__OPTIMIZE__)
+  report["optimized"] = true;
+#else
+  report["optimized"] = false;
+#endif
+  report["timestamp"] = static_cast<int64_t>(time(nullptr));
+  auto& results = report["results"] = nlohmann::json::array();
+  BenchSubmitThroughput(config, results);
+  BenchSubmitLatency(config, results);
+  BenchFanOutFanIn(config, results);
+  BenchResultGet(config, results);
+
+  if (config.Out.empty()) {
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+  }
+  std::ofstream out(config.Out);
+  if (!out) {
+    std::cerr << "Failed to open [" << config.Out << "]" << std::endl;
+    return 1;
+  }
+  out << report.dump(2) << std::endl;
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <future>
+#include <thread>
+
+#include "coro.hpp"
+
+seeker::CoTask<int> Handler(seeker::ThreadPool& pool, int id, std::atomic<int>& in_flight,
+                            std::atomic<int>& max_in_flight) {
+  co_await seeker::Schedule(pool);
+  auto now = in_flight.fetch_add(1) + 1;
+  auto max = max_in_flight.load();
+  while (now > max && !max_in_flight.compare_exchange_weak(max, now)) {}
+  // 睡眠期间不占用线程池线程
+  co_await seeker::SleepFor(std::chrono::milliseconds(100));
+  in_flight.fetch_sub(1);
+  co_return id;
+}
+
+seeker::CoTask<void> FanOut(seeker::ThreadPool& pool, int num, std::atomic<int>& sum,
+                            std::atomic<int>& max_in_flight) {
+  std::atomic<int> in_flight{0};
+  std::vector<seeker::CoTask<void> > tasks;
+  for (int i = 0; i < num; i++) {
+    tasks.push_back([](seeker::ThreadPool& pool, int id, std::atomic<int>& sum, std::atomic<int>& in_flight,
+                       std::atomic<int>& max_in_flight) -> seeker::CoTask<void> {
+      sum.fetch_add(co_await Handler(pool, id, in_flight, max_in_flight));
+    }(pool, i, sum, in_flight, max_in_flight));
+  }
+  co_await seeker::WhenAll(std::move(tasks));
+}
+
+seeker::CoTask<std::string> AwaitTask(seeker::ThreadPool& pool) {
+  co_await seeker::Schedule(pool);
+  // 等待线程池任务的结果, 等待期间不阻塞线程
+  auto value = co_await pool.CreateTask("DOUBLE", [](int v) { return v * 2; }, 21);
+  auto shared = pool.CreateSharedTask("NAME", []() { return std::string("seeker"); });
+  auto name = co_await shared;
+  co_return name + std::to_string(value);
+}
+
+seeker::CoTask<void> Throw(seeker::ThreadPool& pool) {
+  co_await seeker::Schedule(pool);
+  throw std::runtime_error("expected");
+}
+
+seeker::CoTask<int> Sleeper(seeker::ThreadPool& pool) {
+  co_await seeker::Schedule(pool);
+  co_await seeker::SleepFor(std::chrono::seconds(10));
+  co_return 1;
+}
+
+/**
+ * @brief 恢复协程的投递被拒绝或随 Stop 丢弃时, 协程在放弃它的线程上继续执行而不是永远挂起
+ */
+bool TestAbandonedResume() {
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 1;
+  option.Capacity = 1;
+  option.Overflow = seeker::ThreadPool::REJECT;
+  seeker::ThreadPool bounded(option);
+  bounded.Start();
+  std::promise<void> gate;
+  std::promise<void> started;
+  auto opened = gate.get_future().share();
+  bounded.Post("GATE", [opened, &started]() {
+    started.set_value();
+    opened.wait();
+  });
+  started.get_future().wait();
+  bounded.Post("FILL", []() {});
+  auto rejected = seeker::SyncWait([](seeker::ThreadPool& pool) -> seeker::CoTask<int> {
+    co_await seeker::Schedule(pool);
+    co_return 1;
+  }(bounded));
+  gate.set_value();
+  bounded.Stop();
+
+  seeker::ThreadPool pool(1);
+  pool.Start();
+  std::atomic<int> slept{0};
+  std::thread waiter([&]() {
+    slept = seeker::SyncWait(Sleeper(pool));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  pool.Stop();
+  waiter.join();
+  return rejected == 1 && slept == 1;
+}
+
+int main() {
+  seeker::ThreadPool pool(10);
+  pool.Start();
+
+  const int num = 5000;
+  std::atomic<int> sum{0};
+  std::atomic<int> max_in_flight{0};
+  auto begin = std::chrono::steady_clock::now();
+  seeker::SyncWait(FanOut(pool, num, sum, max_in_flight));
+  auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin).count();
+
+  auto str = seeker::SyncWait(AwaitTask(pool));
+  bool thrown = false;
+  try {
+    seeker::SyncWait(Throw(pool));
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  pool.Stop();
+  bool abandoned = TestAbandonedResume();
+
+  bool ok = sum == num * (num - 1) / 2 && max_in_flight > 10 && str == "seeker42" && thrown && abandoned;
+  std::cout << "CORO HANDLERS: " << num
+            << " THREADS: " << pool.ThreadNum()
+            << " MAX IN FLIGHT: " << max_in_flight.load()
+            << " COST: " << cost << "ms"
+            << " RESULT: " << str
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
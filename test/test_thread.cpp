@@ -1,8 +1,10 @@
+#include <time.h>
 #include <unistd.h>
 
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <queue>
 #include <string>
@@ -10,6 +12,10 @@
 #include <condition_variable>
 #include <memory>
 #include <functional>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
 // #include "../src/thread.h"
 #include "thread.h"
 #include "thread.hpp"
@@ -20,7 +26,1381 @@ void Test1(int a) {
   // return a+b;
 }
 
+bool TestWorkStealing() {
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 4;
+  option.Mode = seeker::ThreadPool::WORK_STEALING;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+
+  std::atomic<int> count{0};
+  std::vector<std::shared_ptr<seeker::Task<int> > > tasks;
+  for (int i = 0; i < 64; i++) {
+    // 子任务由工作线程提交, 进入本地队列, 供其他线程窃取
+    tasks.push_back(tp.CreateTask("SPAWN", [&tp, &count](int n) {
+      std::vector<std::shared_ptr<seeker::Task<void> > > subs;
+      for (int j = 0; j < n; j++) {
+        subs.push_back(tp.CreateTask("SUB", [&count]() {
+          count.fetch_add(1);
+        }));
+      }
+      return n;
+    }, 16));
+  }
+  int sum = 0;
+  for (auto& task : tasks) {
+    sum += task->result().get();
+  }
+  // 子任务没有返回给提交方, 以计数判断是否全部执行
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (count.load() != sum && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  bool ok = sum == 64 * 16 && count.load() == sum;
+  std::cout << "WORK STEALING"
+            << " NAME: " << tasks[0]->name()
+            << " START: " << tasks[0]->start_time()
+            << " DONE: " << tasks[0]->done_time()
+            << " SUB TASKS: " << count.load()
+            << (ok ? " OK" : " FAILED") << std::endl;
+  tp.Stop();
+  return ok;
+}
+
+bool TestConcurrentExecution(seeker::ThreadPool::MODE mode) {
+  const int num = 8;
+  const auto sleep = std::chrono::milliseconds(200);
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = num;
+  option.Mode = mode;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::shared_ptr<seeker::Task<void> > > tasks;
+  for (int i = 0; i < num; i++) {
+    tasks.push_back(tp.CreateTask("SLEEP", [sleep]() {
+      std::this_thread::sleep_for(sleep);
+    }));
+  }
+  for (auto& task : tasks) {
+    task->result().get();
+  }
+  auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin);
+  tp.Stop();
+
+  // N 个任务并行执行, 耗时应接近串行的 1/N, 留一倍余量
+  auto serial = sleep * num;
+  bool ok = cost < serial / num * 2;
+  std::cout << "CONCURRENT MODE: " << mode
+            << " TASKS: " << num
+            << " COST: " << cost.count() << "ms"
+            << " SERIAL: " << serial.count() << "ms"
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestPost() {
+  seeker::ThreadPool tp(4);
+  tp.Start();
+
+  std::atomic<int> count{0};
+  for (int i = 0; i < 1000; i++) {
+    tp.Post("POST", [&count](int n) { count.fetch_add(n); }, 1);
+  }
+  auto task = tp.CreateTask("THROW", []() -> int { throw std::runtime_error("expected"); });
+  bool caught = false;
+  try {
+    task->result().get();
+  } catch (const std::runtime_error&) {
+    caught = true;
+  }
+  while (count.load() != 1000) {
+    std::this_thread::yield();
+  }
+  tp.Stop();
+
+  // 同名任务共享驻留的任务名
+  bool same = &task->name() == seeker::TaskBase::InternName("THROW");
+  bool ok = caught && same;
+  std::cout << "POST COUNT: " << count.load()
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestTimer() {
+  seeker::ThreadPool tp(2);
+  tp.Start();
+
+  std::atomic<int> once{0};
+  std::atomic<int> every{0};
+  std::atomic<int> cancelled{0};
+  auto begin = std::chrono::steady_clock::now();
+  std::atomic<int64_t> after_ms{0};
+  tp.ScheduleAfter(std::chrono::milliseconds(50), [&]() {
+    after_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    once.fetch_add(1);
+  });
+  auto id = tp.ScheduleEvery(std::chrono::milliseconds(10), [&]() {
+    every.fetch_add(1);
+  });
+  auto cancel_id = tp.ScheduleAfter(std::chrono::milliseconds(30), [&]() {
+    cancelled.fetch_add(1);
+  });
+  tp.CancelTimer(cancel_id);
+  // 大量定时器共用一个时间轮线程
+  std::atomic<int> many{0};
+  for (int i = 0; i < 10000; i++) {
+    tp.ScheduleAfter(std::chrono::milliseconds(i % 100), [&]() { many.fetch_add(1); });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  tp.CancelTimer(id);
+  auto ticks = every.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  tp.Stop();
+
+  bool ok = once == 1 && after_ms >= 50 && cancelled == 0 && many == 10000 &&
+            ticks >= 10 && every.load() <= ticks + 1;
+
+  // 某次触发被拒绝后, 之后的触发照常执行
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 1;
+  option.Capacity = 1;
+  option.Overflow = seeker::ThreadPool::REJECT;
+  seeker::ThreadPool bounded(option);
+  bounded.Start();
+  std::promise<void> gate;
+  auto opened = gate.get_future().share();
+  bounded.Post("BLOCK", [opened]() { opened.wait(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  bounded.Post("FILL", []() {});
+  std::atomic<int> recovered{0};
+  auto recover_id = bounded.ScheduleEvery(std::chrono::milliseconds(2), [&]() {
+    recovered.fetch_add(1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  gate.set_value();
+  for (int i = 0; i < 100 && recovered.load() == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  bounded.CancelTimer(recover_id);
+  bounded.Stop();
+  ok = ok && recovered.load() > 0;
+  std::cout << "TIMER AFTER: " << after_ms << "ms"
+            << " EVERY: " << ticks
+            << " MANY: " << many.load()
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestPriority() {
+  seeker::ThreadPool tp(1);
+  tp.Start();
+
+  // 先占住唯一的线程, 让后续任务排队
+  std::promise<void> gate;
+  auto blocker = gate.get_future().share();
+  tp.Post("BLOCK", [blocker]() { blocker.wait(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  std::mutex mutex;
+  std::vector<seeker::ThreadPool::PRIORITY> order;
+  auto record = [&](seeker::ThreadPool::PRIORITY p) {
+    std::lock_guard<std::mutex> l(mutex);
+    order.push_back(p);
+  };
+  for (int i = 0; i < 40; i++) {
+    tp.Post(seeker::ThreadPool::BACKGROUND, "UpdateLog", record, seeker::ThreadPool::BACKGROUND);
+  }
+  for (int i = 0; i < 40; i++) {
+    tp.Post(seeker::ThreadPool::HIGH, "notifyCfg", record, seeker::ThreadPool::HIGH);
+  }
+  auto depth_high = tp.QueueDepth(seeker::ThreadPool::HIGH);
+  auto depth_bg = tp.QueueDepth(seeker::ThreadPool::BACKGROUND);
+  gate.set_value();
+  tp.CreateTask(seeker::ThreadPool::BACKGROUND, "LAST", [](){})->result().get();
+  tp.Stop();
+
+  // 高优先级任务虽然后提交, 但应先于大部分后台任务执行, 后台任务也不会被饿死
+  size_t first_bg = 0;
+  while (first_bg < order.size() && order[first_bg] != seeker::ThreadPool::BACKGROUND) {
+    first_bg++;
+  }
+  bool ok = depth_high == 40 && depth_bg == 40 && order.size() == 80 &&
+            first_bg >= 16 && first_bg < 40;
+  std::cout << "PRIORITY DEPTH HIGH: " << depth_high
+            << " BACKGROUND: " << depth_bg
+            << " FIRST BACKGROUND AT: " << first_bg
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+template <class Func>
+int64_t CostMs(Func&& func) {
+  auto begin = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin).count();
+}
+
+bool TestParallel() {
+  seeker::ThreadPool tp(std::max(2u, std::thread::hardware_concurrency()));
+  tp.Start();
+
+  const size_t num = 1 << 22;
+  std::vector<double> serial(num), parallel(num);
+  auto serial_for = CostMs([&]() {
+    for (size_t i = 0; i < num; i++) {
+      serial[i] = std::sqrt(static_cast<double>(i)) * std::sin(i);
+    }
+  });
+  auto parallel_for = CostMs([&]() {
+    tp.ParallelFor(size_t(0), num, 0, [&](size_t i) {
+      parallel[i] = std::sqrt(static_cast<double>(i)) * std::sin(i);
+    });
+  });
+
+  uint64_t serial_sum = 0, parallel_sum = 0;
+  auto serial_reduce = CostMs([&]() {
+    for (size_t i = 0; i < num; i++) {
+      serial_sum += i % 7;
+    }
+  });
+  auto parallel_reduce = CostMs([&]() {
+    parallel_sum = tp.ParallelReduce(size_t(0), num, 0, uint64_t(0),
+                                     [](uint64_t acc, size_t i) { return acc + i % 7; },
+                                     [](uint64_t a, uint64_t b) { return a + b; });
+  });
+
+  std::vector<uint32_t> data(num);
+  uint32_t seed = 1;
+  for (auto& i : data) {
+    seed = seed * 1664525u + 1013904223u;
+    i = seed;
+  }
+  auto sorted = data;
+  auto serial_sort = CostMs([&]() { std::sort(sorted.begin(), sorted.end()); });
+  auto parallel_sort = CostMs([&]() { tp.ParallelSort(data.begin(), data.end()); });
+  // 非平凡类型与自定义比较
+  std::vector<std::string> words;
+  for (size_t i = 0; i < 50000; i++) {
+    words.push_back(std::to_string(data[i] % 10007));
+  }
+  auto words_sorted = words;
+  std::sort(words_sorted.begin(), words_sorted.end(), std::greater<>());
+  tp.ParallelSort(words.begin(), words.end(), std::greater<>());
+  // 不可默认构造的类型同样并行排序
+  std::vector<std::reference_wrapper<const std::string> > refs(words_sorted.rbegin(), words_sorted.rend());
+  tp.ParallelSort(refs.begin(), refs.end(), [](const std::string& a, const std::string& b) { return a > b; });
+  bool refs_sorted = std::equal(refs.begin(), refs.end(), words_sorted.begin(),
+                                [](const std::string& a, const std::string& b) { return a == b; });
+
+  bool thrown = false;
+  try {
+    tp.ParallelFor(0, 1000, 1, [](int i) {
+      if (i == 500) {
+        throw std::runtime_error("expected");
+      }
+    });
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  tp.Stop();
+
+  bool ok = serial == parallel && serial_sum == parallel_sum && sorted == data && 
+            words == words_sorted && refs_sorted && thrown;
+  std::cout << "PARALLEL THREADS: " << tp.ThreadNum()
+            << " FOR: " << serial_for << "ms/" << parallel_for << "ms"
+            << " REDUCE: " << serial_reduce << "ms/" << parallel_reduce << "ms"
+            << " SORT: " << serial_sort << "ms/" << parallel_sort << "ms"
+            << " (SERIAL/PARALLEL)"
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestContinuation() {
+  seeker::ThreadPool tp(2);
+  tp.Start();
+
+  auto chain = tp.CreateTask("STEP1", []() { return 20; })
+                 ->Then([](int v) { return v + 1; })
+                 ->Then([](int v) { return std::to_string(v * 2); });
+
+  auto failed = tp.CreateTask("FAIL", []() -> int { throw std::runtime_error("expected"); })
+                  ->Then([](int v) { return v; });
+  bool propagated = false;
+  try {
+    failed->result().get();
+  } catch (const std::runtime_error&) {
+    propagated = true;
+  }
+
+  auto shared = tp.CreateSharedTask("SHARED", []() { return 3; });
+  auto left = shared->Then([](const int& v) { return v * 2; });
+  auto right = shared->Then([](const int& v) { return v * 3; });
+
+  auto slow = tp.CreateTask("SLOW", []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  });
+  auto fast = tp.CreateTask("FAST", []() {});
+  auto any = tp.WhenAny(slow, fast);
+  auto all = tp.WhenAll(slow, fast, left, right);
+
+  auto any_index = any->result().get();
+  all->result().get();
+  bool ok = chain->result().get() == "42" && propagated &&
+            left->result().get() == 6 && right->result().get() == 9 &&
+            any_index == 1 && slow->done() && fast->done();
+  tp.Stop();
+
+  // 后续任务沿用前驱的优先级, 先于已排队的普通任务执行
+  seeker::ThreadPool single(1);
+  single.Start();
+  std::promise<void> gate;
+  auto opened = gate.get_future().share();
+  single.Post("GATE", [opened]() { opened.wait(); });
+  std::mutex mutex;
+  std::vector<std::string> order;
+  auto record = [&](const char* name) {
+    std::lock_guard<std::mutex> l(mutex);
+    order.push_back(name);
+  };
+  auto high = single.CreateTask(seeker::ThreadPool::HIGH, "HIGH", [&]() { record("HIGH"); })
+                ->Then([&]() { record("THEN"); });
+  auto normal = single.CreateTask("NORMAL", [&]() { record("NORMAL"); });
+  gate.set_value();
+  high->result().get();
+  normal->result().get();
+  single.Stop();
+  ok = ok && order == std::vector<std::string>{ "HIGH", "THEN", "NORMAL" };
+
+  // 不属于线程池的任务也能挂后续任务; 前驱从未完成时两者都能释放
+  std::weak_ptr<seeker::Task<void> > bare_ref;
+  {
+    auto bare = std::make_shared<seeker::Task<void> >("BARE", []() {});
+    bare_ref = bare;
+    auto next = bare->Then([]() { return 1; });
+    ok = ok && !next->done();
+  }
+  ok = ok && bare_ref.expired();
+  std::cout << "CONTINUATION CHAIN: 42 ANY: " << any_index
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestElastic(seeker::ThreadPool::MODE mode) {
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 1;
+  option.MaxThreadNum = 4;
+  option.Mode = mode;
+  option.SpawnLatency = std::chrono::milliseconds(5);
+  option.IdleTimeout = std::chrono::milliseconds(100);
+  seeker::ThreadPool tp(option);
+  tp.Start();
+
+  // 任务阻塞使排队时间超过阈值, 线程数逐步扩到上限
+  std::vector<std::shared_ptr<seeker::Task<void> > > tasks;
+  for (int i = 0; i < 8; i++) {
+    tasks.push_back(tp.CreateTask("BURST", []() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }));
+  }
+  size_t peak = 0;
+  for (auto& task : tasks) {
+    peak = std::max(peak, tp.ThreadNum());
+    task->result().get();
+  }
+  // 空闲超时后退回最少线程数
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (tp.ThreadNum() > 1 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto shrunk = tp.ThreadNum();
+
+  bool resized = tp.Resize(3, 4) && tp.ThreadNum() == 3 && !tp.Resize(2, 8);
+  tp.Resize(1);
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (tp.ThreadNum() > 1 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto fixed = tp.CreateTask("FIXED", []() { return 1; })->result().get() == 1;
+  bool ok = peak > 1 && peak <= 4 && shrunk == 1 && resized && fixed && tp.ThreadNum() == 1;
+  tp.Stop();
+  std::cout << "ELASTIC MODE: " << mode
+            << " PEAK: " << peak
+            << " SHRUNK: " << shrunk
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestAffinity() {
+  auto parsed = seeker::NumaTopology::ParseCpuList("0-2,5,8-9\n");
+  bool ok = parsed == std::vector<int>{ 0, 1, 2, 5, 8, 9 };
+
+  auto& topology = seeker::NumaTopology::GetInstance();
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 4;
+  option.Mode = seeker::ThreadPool::WORK_STEALING;
+  option.Affinity = seeker::ThreadPool::PIN_CPU;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+  std::vector<std::shared_ptr<seeker::Task<int> > > tasks;
+  for (int i = 0; i < 16; i++) {
+    tasks.push_back(tp.CreateTask("AFFINITY", []() {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+      return CPU_COUNT(&set);
+    }));
+  }
+  for (auto& task : tasks) {
+    ok = task->result().get() == 1 && ok;
+  }
+  tp.Stop();
+
+  // 单节点时按节点绑定不改变线程的 CPU 范围
+  option.Affinity = seeker::ThreadPool::PIN_NODE;
+  seeker::ThreadPool node_tp(option);
+  node_tp.Start();
+  auto sum = node_tp.CreateTask("NODE", []() { return 20; })
+                    ->Then([](int v) { return v + 22; });
+  ok = sum->result().get() == 42 && ok;
+  node_tp.Stop();
+  std::cout << "AFFINITY NODES: " << topology.node_num()
+            << " NODE0 CPUS: " << topology.cpus(0).size()
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestOverflow() {
+  using Pool = seeker::ThreadPool;
+  bool ok = true;
+  std::string stats;
+  for (auto policy : { Pool::BLOCK, Pool::REJECT, Pool::CALLER_RUNS, Pool::DROP_OLDEST }) {
+    Pool::Option option;
+    option.ThreadNum = 1;
+    option.Capacity = 4;
+    option.Overflow = policy;
+    Pool tp(option);
+    tp.Start();
+
+    // 占住唯一的线程, 使后续任务排队
+    std::promise<void> gate;
+    auto opened = gate.get_future().share();
+    auto running = std::make_shared<std::promise<void> >();
+    auto started = running->get_future();
+    auto blocker = tp.CreateTask("BLOCKER", [opened, running]() {
+      running->set_value();
+      opened.wait();
+    });
+    started.wait();
+    std::vector<std::shared_ptr<seeker::Task<std::thread::id> > > queued;
+    for (int i = 0; i < 4; i++) {
+      queued.push_back(tp.CreateTask("QUEUED", []() { return std::this_thread::get_id(); }));
+    }
+
+    std::shared_ptr<seeker::Task<std::thread::id> > extra;
+    std::thread producer([&]() {
+      extra = tp.CreateTask(Pool::HIGH, "EXTRA", []() { return std::this_thread::get_id(); });
+    });
+    auto producer_id = producer.get_id();
+    if (policy == Pool::BLOCK) {
+      // 提交方阻塞, 放行后才能返回
+      while (tp.GetOverflowStats().Blocked == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      gate.set_value();
+      producer.join();
+    } else {
+      producer.join();
+      gate.set_value();
+    }
+
+    auto rejected = [](std::shared_ptr<seeker::Task<std::thread::id> >& task) {
+      try {
+        task->result().get();
+      } catch (const seeker::RejectedError&) {
+        return true;
+      }
+      return false;
+    };
+    auto s = tp.GetOverflowStats();
+    switch (policy) {
+      case Pool::BLOCK:
+        ok = ok && s.Blocked == 1 && extra->result().get() != producer_id;
+        break;
+      case Pool::REJECT:
+        ok = ok && s.Rejected == 1 && rejected(extra);
+        break;
+      case Pool::CALLER_RUNS:
+        ok = ok && s.CallerRuns == 1 && extra->result().get() == producer_id;
+        break;
+      case Pool::DROP_OLDEST:
+        ok = ok && s.Dropped == 1 && rejected(queued[0]) && !rejected(extra);
+        queued.erase(queued.begin());
+        break;
+    }
+    for (auto& task : queued) {
+      ok = ok && !rejected(task);
+    }
+    blocker->result().get();
+    tp.Stop();
+    stats += " " + std::to_string(s.Blocked + s.Rejected + s.CallerRuns + s.Dropped);
+  }
+
+  // 时间轮线程不阻塞, 越过上限入队; 出队的任务已取消时同样腾出空位, 阻塞的提交方被唤醒
+  Pool::Option option;
+  option.ThreadNum = 1;
+  option.Capacity = 1;
+  Pool tp(option);
+  tp.Start();
+  auto block = [&tp]() {
+    auto gate = std::make_shared<std::promise<void> >();
+    auto running = std::make_shared<std::promise<void> >();
+    tp.Post("BLOCKER", [opened = gate->get_future().share(), running]() {
+      running->set_value();
+      opened.wait();
+    });
+    running->get_future().wait();
+    return gate;
+  };
+  auto gate = block();
+  tp.Post("QUEUED", []() {});
+  std::atomic<int> fired{0};
+  tp.ScheduleAfter(std::chrono::milliseconds(1), [&fired]() { fired++; });
+  tp.ScheduleAfter(std::chrono::milliseconds(2), [&fired]() { fired++; });
+  for (int i = 0; i < 1000 && tp.QueueDepth(Pool::NORMAL) < 3; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ok = ok && tp.QueueDepth(Pool::NORMAL) == 3;
+  gate->set_value();
+  for (int i = 0; i < 1000 && fired < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ok = ok && fired == 2;
+
+  gate = block();
+  Pool::TaskOption cancel_option;
+  auto token = cancel_option.Token = seeker::CancellationToken();
+  tp.Post(cancel_option, "CANCELLED", []() {});
+  auto blocked = tp.GetOverflowStats().Blocked;
+  std::thread producer([&]() {
+    tp.Post("AFTER_CANCEL", []() {});
+  });
+  while (tp.GetOverflowStats().Blocked == blocked) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  token.Cancel();
+  gate->set_value();
+  producer.join();
+
+  // 被 Stop 唤醒的提交方不再入队, 任务以取消结束
+  gate = block();
+  tp.Post("QUEUED", []() {});
+  blocked = tp.GetOverflowStats().Blocked;
+  std::shared_ptr<seeker::Task<void> > late;
+  std::thread late_producer([&]() {
+    late = tp.CreateTask("LATE", []() {});
+  });
+  while (tp.GetOverflowStats().Blocked == blocked) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::thread stopper([&tp]() { tp.Stop(); });
+  late_producer.join();
+  // 仍有任务在执行时已经结束, 而不是等 Stop 清空队列
+  ok = ok && late->done();
+  gate->set_value();
+  stopper.join();
+  try {
+    late->result().get();
+    ok = false;
+  } catch (const seeker::CancelledError&) {
+  }
+  ok = ok && tp.QueueDepth(Pool::NORMAL) == 0;
+  std::cout << "OVERFLOW BLOCK/REJECT/CALLER_RUNS/DROP_OLDEST:" << stats
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestLatencyStats() {
+  seeker::ThreadPool tp(1);
+  tp.Start();
+  std::vector<std::shared_ptr<seeker::Task<void> > > tasks;
+  for (int i = 0; i < 20; i++) {
+    tasks.push_back(tp.CreateTask("STATS", []() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }));
+  }
+  for (auto& task : tasks) {
+    task->result().get();
+  }
+  auto& last = tasks.back();
+  // 结果就绪后才记录耗时, 以完成回调为准
+  while (!last->done()) {
+    std::this_thread::yield();
+  }
+  bool ok = last->enqueue_time_ns() <= last->start_time_ns() &&
+            last->start_time_ns() <= last->done_time_ns();
+
+  seeker::ThreadPool::TaskStats stats;
+  ok = tp.GetTaskStats("STATS", stats) && !tp.GetTaskStats("MISSING", stats) && ok;
+  auto run_p50 = stats.RunTime.Percentile(50);
+  auto wait_p99 = stats.QueueWait.Percentile(99);
+  // 单线程依次执行, 最后一个任务排队时长接近前面所有任务的执行时长
+  ok = ok && stats.RunTime.Count == 20 && stats.QueueWait.Count == 20 &&
+       run_p50 >= 2000000 && run_p50 < 100000000 &&
+       wait_p99 >= 15 * 2000000 && wait_p99 <= stats.QueueWait.Max &&
+       tp.GetTaskStats().size() == 1;
+  tp.Stop();
+  std::cout << "LATENCY RUN P50: " << run_p50 / 1000 << "us"
+            << " WAIT P99: " << wait_p99 / 1000 << "us"
+            << " WAIT MEAN: " << static_cast<uint64_t>(stats.QueueWait.Mean()) / 1000 << "us"
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestCancellation() {
+  using Pool = seeker::ThreadPool;
+  Pool tp(1);
+  tp.Start();
+
+  std::promise<void> gate;
+  auto opened = gate.get_future().share();
+  auto blocker = tp.CreateTask("BLOCKER", [opened]() { opened.wait(); });
+
+  std::atomic<int> ran{0};
+  Pool::TaskOption cancel_option(Pool::HIGH);
+  auto token = cancel_option.Token = seeker::CancellationToken();
+  auto cancelled = tp.CreateTask(cancel_option, "CANCELLED", [&ran]() { ran++; });
+  auto then = cancelled->Then([&ran]() { ran++; });
+
+  Pool::TaskOption deadline_option;
+  deadline_option.Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+  auto expired = tp.CreateTask(deadline_option, "EXPIRED", [&ran]() { ran++; return 1; });
+
+  Pool::TaskOption poll_option;
+  poll_option.Token = seeker::CancellationToken();
+  auto poll_token = poll_option.Token;
+  auto polling = tp.CreateTask(poll_option, "POLLING", []() {
+    int loops = 0;
+    while (!Pool::CurrentTask()->cancelled()) {
+      ++loops;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return loops;
+  });
+
+  token.Cancel();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  gate.set_value();
+
+  auto is_cancelled = [](auto& task) {
+    try {
+      task->result().get();
+    } catch (const seeker::CancelledError&) {
+      return true;
+    }
+    return false;
+  };
+  bool ok = is_cancelled(cancelled) && is_cancelled(expired);
+  // 执行中的任务只能自行检查令牌
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  poll_token.Cancel();
+  auto loops = polling->result().get();
+  // 后续任务排在轮询任务之后, 沿用同一令牌
+  ok = ok && is_cancelled(then) && ran.load() == 0 && loops > 0 && Pool::CurrentTask() == nullptr;
+  tp.Stop();
+  // 停止时仍在共享队列中的任务以取消结束
+  for (auto mode : { Pool::SHARED_QUEUE, Pool::WORK_STEALING }) {
+    Pool::Option option;
+    option.ThreadNum = 1;
+    option.Mode = mode;
+    Pool stopping(option);
+    stopping.Start();
+    std::promise<void> busy;
+    stopping.Post("BUSY", [&busy]() {
+      busy.set_value();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    busy.get_future().wait();
+    auto queued = stopping.CreateTask("QUEUED", [&ran]() { ran++; });
+    stopping.Stop();
+    ok = ok && queued->result().WaitFor(std::chrono::milliseconds(500)) && is_cancelled(queued) &&
+         ran.load() == 0 && stopping.QueueDepth(Pool::NORMAL) == 0;
+  }
+  std::cout << "CANCELLATION SKIPPED: 3 POLL LOOPS: " << loops
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestSerialExecutor() {
+  const int keys = 4;
+  const int per_key = 50;
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 4;
+  option.Mode = seeker::ThreadPool::WORK_STEALING;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+  seeker::SerialExecutor serial(tp);
+
+  std::vector<std::vector<int> > orders(keys);
+  std::vector<std::atomic<int> > running(keys);
+  std::atomic<int> overlapped{0};
+  std::atomic<int> max_parallel{0};
+  std::atomic<int> parallel{0};
+  std::vector<std::shared_ptr<seeker::Task<void> > > tasks;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < per_key; i++) {
+    for (int k = 0; k < keys; k++) {
+      tasks.push_back(serial.CreateTask("KEY" + std::to_string(k), "SERIAL", [&, k, i]() {
+        if (running[k].fetch_add(1) != 0) {
+          overlapped++;
+        }
+        auto now = parallel.fetch_add(1) + 1;
+        auto max = max_parallel.load();
+        while (now > max && !max_parallel.compare_exchange_weak(max, now)) {}
+        // 同一 key 串行执行, orders[k] 无需加锁
+        orders[k].push_back(i);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        parallel.fetch_sub(1);
+        running[k].fetch_sub(1);
+      }));
+    }
+  }
+  for (auto& task : tasks) {
+    task->result().get();
+  }
+  auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin);
+  while (serial.KeyNum() != 0) {
+    std::this_thread::yield();
+  }
+
+  bool ok = overlapped.load() == 0 && max_parallel.load() > 1;
+  for (auto& order : orders) {
+    ok = ok && order.size() == per_key && std::is_sorted(order.begin(), order.end());
+  }
+
+  seeker::Strand strand(tp);
+  std::string text;
+  for (char c : std::string("strand")) {
+    strand.Post("STRAND", [&text, c]() { text.push_back(c); });
+  }
+  auto last = strand.CreateTask("STRAND", [&text]() { return text; });
+  ok = ok && last->result().get() == "strand";
+  tp.Stop();
+  std::cout << "SERIAL KEYS: " << keys
+            << " MAX PARALLEL: " << max_parallel.load()
+            << " COST: " << cost.count() << "ms"
+            << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestIdlePolicy() {
+  const int rounds = 2000;
+  bool ok = true;
+  std::string report;
+  for (auto policy : { seeker::ThreadPool::PARK, seeker::ThreadPool::SPIN_THEN_PARK }) {
+    for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+      seeker::ThreadPool::Option option;
+      option.ThreadNum = 2;
+      option.Mode = mode;
+      option.Idle = policy;
+      seeker::ThreadPool tp(option);
+      tp.Start();
+      // 每次提交前线程都已空闲, 测量提交到开始执行的延迟
+      for (int i = 0; i < rounds; i++) {
+        tp.CreateTask("IDLE", []() {})->result().get();
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+      }
+      seeker::ThreadPool::TaskStats stats;
+      ok = tp.GetTaskStats("IDLE", stats) && ok;
+      ok = ok && stats.QueueWait.Count <= rounds && stats.QueueWait.Count + 2 >= rounds;
+      tp.Stop();
+      report += std::string(policy == seeker::ThreadPool::PARK ? " PARK" : " SPIN") +
+                (mode == seeker::ThreadPool::SHARED_QUEUE ? "/SHARED" : "/STEALING") +
+                " P50: " + std::to_string(stats.QueueWait.Percentile(50) / 1000) + "us" +
+                " P99: " + std::to_string(stats.QueueWait.Percentile(99) / 1000) + "us";
+    }
+  }
+  std::cout << "IDLE SUBMIT TO START" << report << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestBatch() {
+  bool ok = true;
+  std::vector<int> inputs(1000);
+  std::iota(inputs.begin(), inputs.end(), 0);
+  for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+    seeker::ThreadPool::Option option;
+    option.ThreadNum = 4;
+    option.Mode = mode;
+    seeker::ThreadPool tp(option);
+    tp.Start();
+    auto tasks = tp.CreateTasks("BATCH", inputs.begin(), inputs.end(), [](int i) { return i * i; });
+    ok = ok && tasks.size() == inputs.size();
+    for (size_t i = 0; ok && i < tasks.size(); i++) {
+      ok = tasks[i]->result().get() == inputs[i] * inputs[i];
+    }
+    // 池内线程批量提交, 进入本地队列后可被其他线程窃取
+    auto nested = tp.CreateTask("FANOUT", [&tp, &inputs]() {
+      auto tasks = tp.CreateTasks("BATCH", inputs.begin(), inputs.end(), [](int i) { return i + 1; });
+      long sum = 0;
+      for (auto& task : tasks) {
+        sum += task->result().get();
+      }
+      return sum;
+    });
+    ok = ok && nested->result().get() == 1000L * 1001 / 2;
+    tp.Stop();
+  }
+
+  // 单线程时同一批任务按批内顺序执行
+  seeker::ThreadPool tp(1);
+  tp.Start();
+  std::vector<int> order;
+  auto tasks = tp.CreateTasks("ORDER", inputs.begin(), inputs.begin() + 100,
+                              [&order](int i) { order.push_back(i); });
+  tasks.back()->result().get();
+  ok = ok && std::equal(order.begin(), order.end(), inputs.begin()) && order.size() == 100;
+  tp.Stop();
+  std::cout << "BATCH" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestFuture() {
+  bool ok = true;
+  // 未设置结果时超时, 跨线程设置后唤醒休眠的等待方
+  seeker::Promise<int> promise;
+  auto future = promise.GetFuture();
+  ok = ok && !future.WaitFor(std::chrono::milliseconds(5)) && future.TryGet() == nullptr;
+  std::thread setter([&promise]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    promise.SetValue(7);
+  });
+  auto shared = future.Share();
+  ok = ok && shared.get() == 7 && *shared.TryGet() == 7;
+  setter.join();
+
+  bool broken = false;
+  auto abandoned = std::make_unique<seeker::Promise<void> >();
+  auto orphan = abandoned->GetFuture();
+  abandoned.reset();
+  try {
+    orphan.get();
+  } catch (const std::future_error& e) {
+    broken = e.code() == std::future_errc::broken_promise;
+  }
+  ok = ok && broken;
+
+  seeker::ThreadPool tp(2);
+  tp.Start();
+  auto task = tp.CreateTask("FUTURE", []() { return std::string("done"); });
+  auto result = task->result();
+  result.Wait();
+  ok = ok && result.ready() && *result.TryGet() == "done" && result.get() == "done";
+  // 结果只能取走一次, 再次取走时抛出而不是返回已被移走的值
+  auto no_state = [](auto&& func) {
+    try {
+      func();
+    } catch (const std::future_error& e) {
+      return e.code() == std::future_errc::no_state;
+    }
+    return false;
+  };
+  ok = ok && no_state([&]() { task->result().get(); }) && no_state([&]() { result.get(); });
+  // 无共享状态的 Future 同样抛出, void 结果取走后也不能再查询
+  seeker::Future<int> empty;
+  auto done = tp.CreateTask("FUTURE", []() {});
+  auto done_result = done->result();
+  done_result.Wait();
+  auto done_again = done->result();
+  done_result.get();
+  ok = ok && !empty.valid() && no_state([&]() { empty.get(); }) && no_state([&]() { empty.Wait(); }) &&
+       no_state([&]() { done_again.TryGet(); });
+  // 返回引用的任务只传递所引用的对象
+  std::string target = "target";
+  auto ref = tp.CreateTask("FUTURE", [&target]() -> std::string& { return target; });
+  ok = ok && &ref->result().get() == &target;
+  bool thrown = false;
+  auto failed = tp.CreateTask("FUTURE", []() { throw std::runtime_error("failed"); });
+  try {
+    while (!failed->result().TryGet()) {}
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  ok = ok && thrown;
+
+  // 小任务的提交到取得结果的耗时
+  const int rounds = 20000;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    tp.CreateTask("FUTURE", [i]() { return i; })->result().get();
+  }
+  auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - begin).count() / rounds;
+  tp.Stop();
+  std::cout << "FUTURE ROUND TRIP: " << cost << "ns" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+long Fib(seeker::ThreadPool& tp, int n) {
+  if (n < 2) {
+    return n;
+  }
+  auto left = tp.CreateTask("FIB", Fib, std::ref(tp), n - 1);
+  auto right = tp.CreateTask("FIB", Fib, std::ref(tp), n - 2);
+  return left->result().get() + right->result().get();
+}
+
+bool TestHelpWhileWaiting() {
+  bool ok = true;
+  std::string report;
+  for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+    // 单线程时线程池线程等待子任务, 不协助执行会死锁
+    for (size_t num : { 1, 4 }) {
+      seeker::ThreadPool::Option option;
+      option.ThreadNum = num;
+      option.Mode = mode;
+      seeker::ThreadPool tp(option);
+      tp.Start();
+      auto begin = std::chrono::steady_clock::now();
+      auto res = tp.CreateTask("FIB", Fib, std::ref(tp), 18)->result().get();
+      auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - begin).count();
+      ok = ok && res == 2584;
+      tp.Stop();
+      report += std::string(mode == seeker::ThreadPool::SHARED_QUEUE ? " SHARED/" : " STEALING/") +
+                std::to_string(num) + ": " + std::to_string(cost) + "ms";
+    }
+  }
+  std::cout << "HELP WHILE WAITING FIB(18)" << report << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestBlocking() {
+  bool ok = true;
+  std::string report;
+  for (auto mode : { seeker::ThreadPool::SHARED_QUEUE, seeker::ThreadPool::WORK_STEALING }) {
+    seeker::ThreadPool::Option option;
+    option.ThreadNum = 2;
+    option.Mode = mode;
+    option.MaxBlockingNum = 2;
+    seeker::ThreadPool tp(option);
+    tp.Start();
+    // 两个线程都阻塞在慢 IO 上, 之后提交的计算任务由补偿线程执行
+    std::atomic<int> blocked{0};
+    std::vector<std::shared_ptr<seeker::Task<void> > > blockers;
+    for (int i = 0; i < 2; i++) {
+      blockers.push_back(tp.CreateTask("BLOCKING", [&blocked]() {
+        seeker::ThreadPool::Blocking([&blocked]() {
+          blocked++;
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        });
+      }));
+    }
+    while (blocked.load() < 2) {
+      std::this_thread::yield();
+    }
+    auto begin = std::chrono::steady_clock::now();
+    tp.CreateTask("COMPUTE", []() { return 1; })->result().get();
+    auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    auto peak = tp.ThreadNum();
+    ok = ok && cost < 150 && peak > 2 && peak <= 4;
+    for (auto& task : blockers) {
+      task->result().get();
+    }
+    // 阻塞结束后补偿线程退出
+    for (int i = 0; i < 100 && tp.ThreadNum() > 2; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ok = ok && tp.ThreadNum() == 2;
+    tp.Stop();
+    report += std::string(mode == seeker::ThreadPool::SHARED_QUEUE ? " SHARED" : " STEALING") +
+              " COMPUTE: " + std::to_string(cost) + "ms PEAK: " + std::to_string(peak);
+  }
+  // 停止期间任务进入阻塞区域, 不能与等待线程退出的 Stop 互相等待
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 1;
+  option.MaxBlockingNum = 1;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+  std::promise<void> started;
+  tp.Post("LATE_BLOCKING", [&started]() {
+    started.set_value();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    seeker::ThreadPool::Blocking([]() {});
+  });
+  tp.Post("QUEUED", []() {});
+  started.get_future().wait();
+  auto begin = std::chrono::steady_clock::now();
+  tp.Stop();
+  auto stop_cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin).count();
+  ok = ok && stop_cost < 1000;
+  report += " STOP: " + std::to_string(stop_cost) + "ms";
+  std::cout << "BLOCKING" << report << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestTaskGraph() {
+  bool ok = true;
+  seeker::ThreadPool tp(4);
+  tp.Start();
+  // cfg → (logger, net) → http, logger 与 net 并行
+  std::mutex mutex;
+  std::vector<std::string> order;
+  auto step = [&](const std::string& name, int ms) {
+    return [&, name, ms]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+      std::lock_guard<std::mutex> l(mutex);
+      order.push_back(name);
+    };
+  };
+  seeker::TaskGraph graph(tp);
+  auto cfg = graph.AddNode("cfg", step("cfg", 10));
+  auto logger = graph.AddNode("logger", step("logger", 30));
+  auto net = graph.AddNode("net", step("net", 10));
+  auto http = graph.AddNode("http", step("http", 10));
+  ok = ok && graph.AddEdge(cfg, logger) && graph.AddEdge(cfg, net) &&
+       graph.AddEdge(logger, http) && graph.AddEdge(net, http) && 
+       !graph.AddEdge(http, cfg) && !graph.AddEdge(cfg, cfg);
+
+  seeker::TaskGraph::Report report;
+  ok = ok && !graph.GetReport(report);
+  // 可重复运行
+  for (int i = 0; i < 3 && ok; i++) {
+    order.clear();
+    graph.Run()->result().get();
+    ok = order.size() == 4 && order.front() == "cfg" && order.back() == "http" && order[1] == "net";
+  }
+  ok = ok && graph.GetReport(report) &&
+       report.CriticalPath == std::vector<seeker::TaskGraph::NodeId>{ cfg, logger, http } &&
+       report.Total >= report.CriticalRunTime && report.CriticalRunTime >= 50000000 &&
+       report.Total < 90000000;
+  std::cout << report.ToString();
+
+  // 出错后不再执行后继节点, 首个异常传给结果任务
+  seeker::TaskGraph failing(tp);
+  std::atomic<bool> ran{false};
+  auto bad = failing.AddNode("bad", []() { throw std::runtime_error("bad node"); });
+  auto after = failing.AddNode("after", [&ran]() { ran = true; });
+  failing.AddEdge(bad, after);
+  bool thrown = false;
+  try {
+    failing.Run()->result().get();
+  } catch (const std::runtime_error& e) {
+    thrown = std::string(e.what()) == "bad node";
+  }
+  ok = ok && thrown && !ran && failing.GetReport(report) && report.Nodes[after].Skipped;
+  seeker::TaskGraph empty(tp);
+  empty.Run()->result().get();
+  tp.Stop();
+  std::cout << "TASK GRAPH" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestPipeline() {
+  bool ok = true;
+  const int num = 2000;
+  const size_t capacity = 16;
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 4;
+  option.Mode = seeker::ThreadPool::WORK_STEALING;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+  std::atomic<int> serial_running{0};
+  std::atomic<bool> overlapped{false};
+  std::vector<int> written;
+  {
+    seeker::Pipeline<int> pipeline(tp, capacity);
+    pipeline.AddStage("parse", seeker::Pipeline<int>::PARALLEL, [](int& v) {
+      v *= 2;
+      return true;
+    }).AddStage("filter", seeker::Pipeline<int>::PARALLEL, [](int& v) {
+      // 丢弃 10 的倍数
+      return v % 10 != 0;
+    }, 2).AddStage("enrich", seeker::Pipeline<int>::SERIAL, [&](int& v) {
+      if (serial_running.fetch_add(1) != 0) {
+        overlapped = true;
+      }
+      v += 1;
+      serial_running.fetch_sub(1);
+      return true;
+    }).AddStage("write", seeker::Pipeline<int>::IN_ORDER, [&](int& v) {
+      written.push_back(v);
+      return true;
+    });
+    for (int i = 0; i < num; i++) {
+      pipeline.Push(i);
+      ok = ok && pipeline.Size() <= capacity;
+    }
+    pipeline.Wait();
+    ok = ok && pipeline.Size() == 0;
+    auto stats = pipeline.GetStats();
+    ok = ok && stats.size() == 4 && stats[0].Processed == num && stats[1].Dropped == num / 5 &&
+         stats[3].Processed == num - num / 5;
+    for (auto& stage : stats) {
+      ok = ok && stage.MaxBuffered <= capacity && stage.Running == 0 && stage.Buffered == 0;
+      std::cout << "PIPELINE STAGE " << stage.Name << " PROCESSED: " << stage.Processed
+                << " DROPPED: " << stage.Dropped << " MAX BUFFERED: " << stage.MaxBuffered
+                << " THROUGHPUT: " << static_cast<uint64_t>(stage.Throughput) << "/s"
+                << " OCCUPANCY: " << stage.Occupancy << std::endl;
+    }
+  }
+  // IN_ORDER 阶段按提交顺序输出, 被丢弃的数据不影响顺序
+  ok = ok && !overlapped && written.size() == num - num / 5;
+  for (size_t i = 1; ok && i < written.size(); i++) {
+    ok = written[i] > written[i - 1];
+  }
+  tp.Stop();
+
+  // 阶段任务被有界队列拒绝时按丢弃处理, 槽位照常释放, Wait 与析构不会卡住
+  option = seeker::ThreadPool::Option();
+  option.ThreadNum = 1;
+  option.Capacity = 1;
+  option.Overflow = seeker::ThreadPool::REJECT;
+  seeker::ThreadPool bounded(option);
+  bounded.Start();
+  std::vector<int> kept;
+  {
+    seeker::Pipeline<int> pipeline(bounded, 8);
+    pipeline.AddStage("slow", seeker::Pipeline<int>::PARALLEL, [](int&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return true;
+    }).AddStage("keep", seeker::Pipeline<int>::IN_ORDER, [&](int& v) {
+      kept.push_back(v);
+      return true;
+    });
+    for (int i = 0; i < 100; i++) {
+      pipeline.Push(i);
+    }
+    pipeline.Wait();
+    ok = ok && pipeline.Size() == 0;
+    for (auto& stage : pipeline.GetStats()) {
+      ok = ok && stage.Running == 0 && stage.Buffered == 0;
+    }
+  }
+  ok = ok && bounded.GetOverflowStats().Rejected > 0 && kept.size() < 100;
+  for (size_t i = 1; ok && i < kept.size(); i++) {
+    ok = kept[i] > kept[i - 1];
+  }
+  bounded.Stop();
+  std::cout << "PIPELINE" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestWatchdog() {
+  bool ok = true;
+  std::mutex mutex;
+  std::vector<seeker::ThreadPool::RunningTask> reports;
+  seeker::ThreadPool* pool = nullptr;
+  size_t running_seen = 0;
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 2;
+  option.StallThreshold = std::chrono::milliseconds(20);
+  option.OnStall = [&](const seeker::ThreadPool::RunningTask& task) {
+    // 回调在锁外执行, 其中可以查询线程池
+    auto health = pool->GetHealth();
+    std::lock_guard<std::mutex> l(mutex);
+    reports.push_back(task);
+    running_seen = health.Running.size();
+  };
+  seeker::ThreadPool tp(option);
+  pool = &tp;
+  tp.Start();
+  std::promise<void> gate;
+  auto opened = gate.get_future().share();
+  auto hung = tp.CreateTask("HUNG", [opened]() { opened.wait(); });
+  for (int i = 0; i < 50 && tp.GetHealth().Stalled == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  auto health = tp.GetHealth();
+  ok = ok && health.ThreadNum == 2 && health.Stalled == 1 && health.Running.size() == 1 &&
+       health.Running[0].Name == "HUNG" && health.Running[0].Age >= std::chrono::milliseconds(20);
+  // 正常的短任务不被报告
+  for (int i = 0; i < 100; i++) {
+    tp.CreateTask("SHORT", []() {})->result().get();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  gate.set_value();
+  hung->result().get();
+  health = tp.GetHealth();
+  ok = ok && health.Running.empty() && health.Stalled == 0;
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    // 同一任务只报告一次
+    ok = ok && reports.size() == 1 && reports[0].Name == "HUNG" && 
+         reports[0].Worker < 2 && running_seen == 1;
+  }
+  tp.Stop();
+  std::cout << "WATCHDOG" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+/**
+ * @brief 占用本线程 CPU 至少 ms 毫秒
+ */
+void BurnCpu(int ms) {
+  timespec start, now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+  volatile uint64_t sink = 0;
+  do {
+    for (int i = 0; i < 10000; i++) {
+      sink = sink + i;
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  } while ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 < ms);
+}
+
+bool TestCpuTime() {
+  bool ok = true;
+  seeker::ThreadPool::Option option;
+  option.ThreadNum = 1;
+  option.RecordCpuTime = true;
+  option.RecordContextSwitch = true;
+  seeker::ThreadPool tp(option);
+  tp.Start();
+  auto burn = tp.CreateTask("BURN", BurnCpu, 20);
+  burn->result().get();
+  auto sleep = tp.CreateTask("SLEEP", []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  });
+  sleep->result().get();
+  ok = ok && burn->cpu_time_ns() >= 20000000 && 
+       sleep->cpu_time_ns() < 10000000 && sleep->voluntary_switches() >= 1;
+  // 单线程池中子任务由等待方协助执行, 其 CPU 时间不计入外层任务
+  std::shared_ptr<seeker::Task<void> > child;
+  auto outer = tp.CreateTask("OUTER", [&]() {
+    child = tp.CreateTask("BURN", BurnCpu, 20);
+    child->result().get();
+  });
+  outer->result().get();
+  ok = ok && child->cpu_time_ns() >= 20000000 && outer->cpu_time_ns() < 10000000;
+
+  seeker::ThreadPool::TaskStats burn_stats, sleep_stats;
+  ok = ok && tp.GetTaskStats("BURN", burn_stats) && tp.GetTaskStats("SLEEP", sleep_stats) &&
+       burn_stats.CpuTime.Count == 2 && burn_stats.CpuRatio() > 0.5 &&
+       sleep_stats.CpuRatio() < 0.5 && sleep_stats.VoluntarySwitches >= 1;
+  std::cout << "BURN CPU RATIO: " << burn_stats.CpuRatio()
+            << " SLEEP CPU RATIO: " << sleep_stats.CpuRatio() << std::endl;
+  tp.Stop();
+  std::cout << "CPU TIME" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
+bool TestExecutor() {
+  bool ok = true;
+  seeker::ThreadPool tp(4);
+  tp.Start();
+  // 配额 2 的执行器在 4 线程池上最多同时执行 2 个任务
+  seeker::Executor executor(tp, "LIMITED", 2);
+  std::atomic<int> running{0};
+  std::atomic<int> peak{0};
+  std::vector<std::shared_ptr<seeker::Task<void> > > tasks;
+  for (int i = 0; i < 12; i++) {
+    tasks.push_back(executor.CreateTask("LIMITED", [&]() {
+      auto now = ++running;
+      auto last = peak.load();
+      while (now > last && !peak.compare_exchange_weak(last, now)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      running--;
+    }));
+  }
+  ok = ok && executor.running() <= 2 && executor.pending() >= 8;
+  for (auto& task : tasks) {
+    task->result().get();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ok = ok && peak.load() == 2 && executor.running() == 0 && executor.pending() == 0;
+
+  // 串行执行器经由执行器投递, Wait 返回时全部完成
+  seeker::SerialExecutor serial(executor);
+  std::vector<int> order;
+  for (int i = 0; i < 20; i++) {
+    serial.Post("KEY", "SERIAL", [&order, i]() { order.push_back(i); });
+  }
+  serial.Wait();
+  std::vector<int> expect(20);
+  std::iota(expect.begin(), expect.end(), 0);
+  ok = ok && order == expect && serial.KeyNum() == 0;
+
+  // 积压达到上限后提交方阻塞, 串行执行器中排队的任务同样计入
+  seeker::Executor bounded(tp, "BOUNDED", 1, 4);
+  seeker::SerialExecutor bounded_serial(bounded);
+  std::promise<void> gate;
+  auto opened = gate.get_future().share();
+  std::atomic<int> submitted{0};
+  std::thread producer([&]() {
+    for (int i = 0; i < 10; i++) {
+      bounded_serial.Post("KEY", "BOUNDED", [opened]() { opened.wait(); });
+      submitted++;
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ok = ok && submitted.load() == 4;
+  gate.set_value();
+  producer.join();
+  bounded_serial.Wait();
+  ok = ok && submitted.load() == 10 && bounded.capacity() == 4;
+
+  // 取消返回后定时任务不再执行
+  std::atomic<int> ticks{0};
+  auto id = executor.ScheduleEvery(std::chrono::milliseconds(2), [&]() {
+    ticks++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  ok = ok && executor.CancelTimer(id) && !executor.CancelTimer(id);
+  auto cancelled = ticks.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ok = ok && cancelled > 0 && ticks.load() == cancelled;
+
+  // 同名执行器共享, 首次获取时的配额生效
+  auto& registry = seeker::ExecutorRegistry::GetInstance();
+  auto a = registry.Get("TEST", 3);
+  auto b = registry.Get("TEST", 5);
+  ok = ok && a == b && b->quota() == 3 && b->name() == "TEST" &&
+       a->CreateTask("SHARED", [](int x) { return x * 2; }, 21)->result().get() == 42;
+  ok = ok && registry.pool().ThreadNum() <= std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  tp.Stop();
+  std::cout << "EXECUTOR" << (ok ? " OK" : " FAILED") << std::endl;
+  return ok;
+}
+
 int main() {
+  if (!TestWorkStealing() ||
+      !TestConcurrentExecution(seeker::ThreadPool::SHARED_QUEUE) ||
+      !TestConcurrentExecution(seeker::ThreadPool::WORK_STEALING) ||
+      !TestPost() ||
+      !TestTimer() ||
+      !TestPriority() ||
+      !TestParallel() ||
+      !TestContinuation() ||
+      !TestElastic(seeker::ThreadPool::SHARED_QUEUE) ||
+      !TestElastic(seeker::ThreadPool::WORK_STEALING) ||
+      !TestAffinity() ||
+      !TestOverflow() ||
+      !TestLatencyStats() ||
+      !TestCancellation() ||
+      !TestSerialExecutor() ||
+      !TestIdlePolicy() ||
+      !TestBatch() ||
+      !TestFuture() ||
+      !TestHelpWhileWaiting() ||
+      !TestBlocking() ||
+      !TestTaskGraph() ||
+      !TestPipeline() ||
+      !TestWatchdog() ||
+      !TestCpuTime() ||
+      !TestExecutor()) {
+    return 1;
+  }
+
   seeker::ThreadPool tp(10);
   tp.Start();
   auto task = tp.CreateTask("TASK1", Test1, 3);